@@ -33,8 +33,46 @@
 #include <utility>
 #include <tuple>
 #include <type_traits>
+#include <limits>
+#include <bit>       // for portable format byte order.
 #include <charconv>  // from_chars and to_chars
 #include <format>    // for format api.
+#include <chrono>    // for compile statistics.
+#include <istream>   // for stream compiling.
+#include <fstream>   // for reloading.
+#include <filesystem>
+
+// Byte swapping kernels of portable format and block checksums.
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// Multithreading headers.
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+// Batch loading submits reads through io_uring with raw syscalls.
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
 
 // Container support headers.
 #include <array>
@@ -48,11 +86,30 @@
 #include <map>
 #include <unordered_map>
 
+// Allocator support headers.
+#include <memory>
+#include <memory_resource>
+
 namespace cpod {
 
     using  flag_t = std::uint32_t;
     class  archive;
 
+    typedef enum std_basic_io_flag{
+        integer_binary            = 1 << 1,
+        integer_heximal           = 1 << 2,
+        floating_point_fixed      = 1 << 3,
+        floating_point_scientific = 1 << 4,
+        string_use_raw            = 1 << 5,
+        // Text writer emits C++ constant-initialized data instead of cpod text, see "Constant emission" below.
+        constant_initialized      = 1 << 6,
+        // Reader replaces contents of containers instead of appending, reusing their elements, capacity, nodes and
+        // string buffers, so reading same shaped data again allocates nothing.
+        read_assign               = 1 << 7,
+        // Reader checks the checksum of the block before decoding it (if it has one), mismatch throws std::runtime_error.
+        verify_checksum           = 1 << 8,
+    } std_basic_io_flag;
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///                                   Variable view implementation
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -105,13 +162,106 @@ namespace cpod {
     template <class Ty>
     struct serializer {};
 
+    // Statistics of one compiler pass, allocations are counted on the scratch memory resource of the compiler.
+    struct compile_phase_statistics {
+        std::string_view        name;
+        std::chrono::nanoseconds wall_time{};
+        std::size_t             input_bytes     = 0;
+        std::size_t             output_bytes    = 0;
+        std::size_t             allocations     = 0;
+        std::size_t             allocated_bytes = 0;
+    };
+
+    struct compile_statistics {
+        std::vector<compile_phase_statistics>            phases;
+        std::size_t                                      token_count      = 0;
+        std::size_t                                      macro_expansions = 0;
+        // Variable name and size of its whole offset block (including the offset word).
+        std::vector<std::pair<std::string, std::size_t>> declaration_sizes;
+    };
+
+    // Options of compile_content_default, default constructed options produce the plain format.
+    struct compile_options {
+        // Record byte offset of every 'sub_index_stride' elements of top level sequential containers,
+        // so that a huge container can be decoded by multiple threads, see archive::parallel_read.
+        // Zero disables the sub-index.
+        std::size_t                 sub_index_stride = 0;
+        // Scratch buffers of the compiler (source copies and declaration tokens) are allocated from this resource,
+        // pass a std::pmr::monotonic_buffer_resource to make a whole compilation a single release.
+        // Null means std::pmr::get_default_resource().
+        std::pmr::memory_resource*  resource         = nullptr;
+        // Filled by the compiler when not null, collecting nothing costs nothing.
+        compile_statistics*         statistics       = nullptr;
+        // Give top level structures a directory of all their (nested) fields, so that a dotted path
+        // such as "scene.mesh.vertices" is read without decoding the rest of the structure.
+        bool                        field_directory  = false;
+        // Store every distinct string once in an archive wide string table (see archive::string_table_name),
+        // values refer to it by a 4 bytes index. Readers may then hand out std::string_view into the archive.
+        // Not supported by archive::compile_stream.
+        bool                        intern_strings   = false;
+        // Give every offset block a CRC32C of its bytes, see offset_block_has_checksum.
+        bool                        checksums        = false;
+    };
+
+    // Highest bits of an offset word are block flags, the rest bits are the size of the block.
+    // Flagged data is appended behind the value so that readers unaware of it can still read the value.
+    typedef enum offset_block_flag : std::size_t {
+        // Trailing layout: [size_t entries[count]][size_t count][size_t stride]
+        // entries[i] is the byte offset of element (i * stride) relative to the value begin.
+        offset_block_has_sub_index = std::size_t(1) << (sizeof(std::size_t) * 8 - 1),
+        // Block was replaced by archive::update and must be skipped.
+        offset_block_erased        = std::size_t(1) << (sizeof(std::size_t) * 8 - 2),
+        // Trailing layout: [entries][size_t entries_size], each entry is [size_t offset][type signature][path\0]
+        // just like the head of an offset block, offset is relative to the value begin and path is dotted.
+        offset_block_has_field_directory = std::size_t(1) << (sizeof(std::size_t) * 8 - 3),
+        // Strings of this value are std::uint32_t indices into the string table instead of null terminated bytes.
+        offset_block_interned_strings    = std::size_t(1) << (sizeof(std::size_t) * 8 - 4),
+        // A std::uint32_t CRC32C of all bytes of the block (offset word included) but itself sits right behind
+        // the value, before the sub-index or field directory which are found from the block end.
+        offset_block_has_checksum        = std::size_t(1) << (sizeof(std::size_t) * 8 - 5),
+        offset_block_flag_mask     = offset_block_has_sub_index | offset_block_erased | offset_block_has_field_directory |
+                                     offset_block_interned_strings | offset_block_has_checksum,
+    } offset_block_flag;
+
+    namespace details {
+        struct string_table_view;
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///                                    Archive declaration
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     
     class archive {
+        friend class snapshot;
+        friend class reloader;
+
         std::string   content_;
         std::size_t   base_indent_count_;
+
+        // Positions of offset words of every alive block.
+        inline std::vector<std::size_t> alive_offset_blocks() const;
+        // Calls visit(index_begin, count, segment_begin) for journal indices from the latest one on until it returns true,
+        // segment_begin is where blocks of that segment start (0 for the oldest, whose blocks follow the plain content).
+        // Returns nullptr or the reason the chain is broken.
+        template <class Visit>
+        const char*                        visit_journal_indices(Visit&& visit) const;
+        // Position of element 'first' of the sequential container whose block starts with tag, [first, last) must be inside it.
+        // With verify, checksum of the block is checked first.
+        inline std::string::const_iterator find_element(std::string_view tag, std::size_t first, std::size_t last, bool& interned,
+                                                        bool verify = false) const;
+        // String table of content, its count is zero if there is none.
+        inline details::string_table_view  string_table() const;
+        // Same as compile_content_default, macro_map holds the initial macros.
+        inline std::string                 compile_content(std::unordered_map<std::string_view, std::string> macro_map,
+                                                           compile_options options) noexcept;
+        // Decodes value of the block, interned strings are resolved with the string table.
+        template <class Ty>
+        void                               read_block_value(std::string::const_iterator block, std::string::const_iterator value,
+                                                            variable_view<Ty> v) const;
+        // Body of append, with keep_trailers each new version gets the field directory or sub-index (and checksum)
+        // of the current one rebuilt for its value like update does.
+        template <class ... Ty>
+        archive&                           append_versions(bool keep_trailers, variable_view<Ty> ... v);
     public:
         
         // Writer mode
@@ -123,11 +273,93 @@ namespace cpod {
         constexpr std::string_view    content() const { return content_; }
 
         // Compile writes compiled code stream to content_.
-        inline    std::string         compile_content_default(std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map = {}) noexcept;
+        inline    std::string         compile_content_default(std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map = {},
+                                                              compile_options options = {}) noexcept;
+
+        // Compiles text read from 'in' in chunks without holding all of it, each top level declaration is compiled
+        // on its own and its offset block is handed to sink (invocable with std::string_view) right away, the end mark
+        // comes last. Memory is bounded by the largest single declaration. Macros take effect from their definition on,
+        // and preprocessor directives must be outside declarations. Returns an empty string on success otherwise
+        // the reason, phase timings of options.statistics are not recorded in this mode.
+        template <std::invocable<std::string_view> Sink>
+        static    std::string         compile_stream(std::istream& in, Sink&& sink,
+                                                     std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map = {},
+                                                     compile_options options = {});
+
+        // Type signature followed by variable name, this is what an offset block starts with.
+        template <class Ty>
+        static constexpr std::string  variable_tag(std::string_view var_name);
+
+        // Checks the whole compiled content once, returns an empty string if it's well formed otherwise the reason.
+        // Offsets, counts, string terminators and sub-indices are all checked against the content size,
+        // after this succeeds reads of this archive need no more checks. Values of structures are checked field by field
+        // through their field directory, so untrusted structures must be compiled with compile_options::field_directory,
+        // those without one (written by write_binary for instance) are rejected since their field types are not recorded.
+        inline    std::string         validate() const noexcept;
+
+        // Blocks compiled with compile_options::checksums carry a CRC32C (crc32 instruction with SSE4.2 or ARMv8 CRC,
+        // slicing-by-8 tables otherwise). validate() checks them along with everything else, verify_checksums() checks
+        // only them at memory speed, and reads with the verify_checksum flag check just the blocks they decode.
+        // Blocks without a checksum are skipped. Returns an empty string on success otherwise the reason.
+        inline    std::string         verify_checksums() const noexcept;
+        // Gives every alive block without a checksum one, journaled content is compacted first and erased blocks
+        // are dropped.
+        inline    void                add_checksums();
+
+        // Returns iterator to the offset word of the block which starts with tag.
+        constexpr std::string::const_iterator find_offset_block(std::string_view tag) const;
+
+        // Converts compiled content back to text using type signatures of its offset blocks only, so no static type
+        // is needed. Text is handed to sink (invocable with std::string_view) in pieces of bounded size in one pass.
+        // Returns an empty string on success otherwise the reason. Structures compiled with compile_options::field_directory
+        // are written with their fields, others are left as comments since their fields are not recorded.
+        // Like reads, untrusted content should pass validate() first.
+        template <std::invocable<std::string_view> Sink>
+        std::string                   decompile(Sink&& sink, flag_t flag = {}) const;
+
+        // Portable content is compiled content with 8 bytes little endian size words (offsets, counts, array extents)
+        // and little endian values, prefixed by portable_magic, so it can be moved between hosts of any byte order
+        // and size_t width. On hosts matching it the conversion is a copy, otherwise bulk arrays of numbers are byte
+        // swapped by vectorized kernels. Structure values can only be converted between equal layouts since their
+        // field types are not recorded. Both return an empty string on success otherwise the reason.
+        static constexpr std::string_view portable_magic = "cpodport";
+
+        inline    std::string         to_portable(std::string& out) const;
+        // Replaces content with native compiled content converted from portable content, untrusted input should
+        // pass validate() after this.
+        inline    std::string         from_portable(std::string_view portable);
+
+        // Journaled content is compiled content followed by appended segments, each segment is new offset blocks and
+        // a delta index of just those blocks: [size_t count][size_t block_offset[count]][size_t previous][size_t index_begin][magic].
+        // previous is index_begin of the segment before (0 for the first one), so indices chain back to the plain content.
+        // Newer blocks win, lookups search the segments from the latest one and then the plain content.
+        static constexpr std::string_view journal_magic = "cpodjrnl";
+
+        constexpr bool                is_journaled() const {
+            return content_.size() >= sizeof(std::size_t) * 3 + journal_magic.size() && content_.ends_with(journal_magic);
+        }
+
+        // Appends new versions of variables as one segment without touching any existing bytes, so a checkpoint
+        // costs about the size of what changed and doesn't depend on how many variables the archive has.
+        // Persist it by writing content() beyond the size saved last time, compact() once segments pile up.
+        template <class ... Ty>
+            requires (sizeof...(Ty) != 0)
+        archive& append(variable_view<Ty> ... v);
+
+        // Rewrites content as plain compiled content with only alive blocks, dropping old versions and erased blocks.
+        inline    void                compact();
 
         template <class Ty>
         constexpr std::string::const_iterator find_variable_begin(std::string_view var_name);
 
+        // Returns iterator to value of the field at a dotted path "variable.field.field" of a structure compiled
+        // with compile_options::field_directory, or end of content if there is no such field.
+        template <class Ty>
+        std::string::const_iterator   find_field_begin(std::string_view path, std::string::const_iterator* block = nullptr) const;
+
+        // Name of the string table block written by compile_options::intern_strings, it's a std::vector<std::string>.
+        static constexpr std::string_view string_table_name = "#strings";
+
         constexpr std::size_t&        indent()        { return base_indent_count_; }
         constexpr std::size_t         indent()  const { return base_indent_count_; }
 
@@ -159,14 +391,53 @@ namespace cpod {
             return *this;
         }
 
+        // Appends variable as a compiled offset block directly, no text formatting nor compiling is involved.
+        // Archive must be empty or hold compiled content.
+        template <class Ty>
+        archive& write_binary(variable_view<Ty> v);
+
         template <class Ty>
         constexpr archive& operator>>(variable_view<Ty> v) {
-            if (auto it = find_variable_begin<Ty>(v.name); it != content_.cend()) {
-                serializer<Ty>{}(it, *v.value, v.flag);
+            const std::string type_and_name = variable_tag<Ty>(v.name);
+            if (auto block = find_offset_block(type_and_name); block != content_.cend()) {
+                read_block_value(block, block + sizeof(std::size_t) + type_and_name.size(), v);
                 return *this;
             }
+            if (v.name.find('.') != std::string_view::npos) {
+                std::string::const_iterator block;
+                if (auto it = find_field_begin<Ty>(v.name, &block); it != content_.cend()) {
+                    read_block_value(block, it, v);
+                    return *this;
+                }
+            }
             throw std::invalid_argument("Can't find variable name!");
         }
+
+        // Replaces value of an existing variable of compiled content. Value of the same encoded size is overwritten
+        // in place, otherwise this block alone is rewritten: blocks behind it are shifted when they are short,
+        // or the old block is marked erased and the new one is relinked to the end, either way cost is about
+        // the size of this variable. A field directory or sub-index of the block is rebuilt for the new value,
+        // it's dropped only when the value no longer matches the field types the directory records.
+        template <class Ty>
+        archive& update(variable_view<Ty> v);
+
+        // Decode one huge std::vector or std::deque by multiple threads, the container is resized once and each thread
+        // fills a disjoint range of it. Elements are appended like operator>> does (or replace the old ones with
+        // read_assign), whatever the thread count is. This requires the variable to be compiled with compile_options::sub_index_stride,
+        // otherwise it falls back to the serial operator>>.
+        template <class Ty>
+        archive& parallel_read(variable_view<Ty> v, std::size_t thread_count = std::thread::hardware_concurrency());
+
+        // Decodes only elements [first, last) of a sequential container (std::vector, std::deque or std::list) and appends
+        // them to the container. Position of 'first' is computed when elements have a fixed size, otherwise looked up
+        // in the sub-index (see compile_options::sub_index_stride) and the remaining elements are skipped without decoding.
+        template <class Ty>
+        archive& read_range(variable_view<Ty> v, std::size_t first, std::size_t last);
+
+        // Same as above but decodes elements [first, first + out.size()) of a std::vector or std::deque into out,
+        // flag plays the role of the flag of v (verify_checksum checks the block first).
+        template <class Ty, std::size_t Extent>
+        archive& read_range(std::string_view var_name, std::span<Ty, Extent> out, std::size_t first, flag_t flag = {});
     };
     
     namespace details {
@@ -268,6 +539,17 @@ template <typename K, typename V, typename ... OtherStuff> \
         DEFINE_DOUBLE_STL_TRAITS(std::unordered_map,      24);
         DEFINE_DOUBLE_STL_TRAITS(std::unordered_multimap, 25);
 
+        // Spans (and so pointer + length of caller owned buffers) are encoded as std::vector, reading into a span
+        // fills it in place and requires the stored count to be the span size.
+        template <typename Ty, std::size_t Extent>
+        struct std_template_library_type_traits<std::span<Ty, Extent>> : std::true_type {
+            static constexpr bool             is_resizeable      = false;
+            static constexpr bool             is_mono            = true;
+            static constexpr bool             is_double          = false;
+            static constexpr std::string_view name               = "std::vector";
+            static constexpr std::uint8_t     identifier         = 13;
+        };
+
         template <typename K, typename V>
         struct std_template_library_type_traits<std::pair<K, V>> : std::true_type {
             static constexpr bool             is_resizeable      = false;
@@ -304,9 +586,183 @@ template <typename K, typename V, typename ... OtherStuff> \
         template <class Ty>
         concept std_template_library_range = std_template_library_type_traits<Ty>::is_mono || std_template_library_type_traits<Ty>::is_double;
 
+        // Structure whose members are known (automatic aggregates or field described), it can be nested inside
+        // std containers where it's written as a std::tuple of its members, which the compiler understands.
+        template <class Ty>
+        concept positional_structure = std::is_class_v<Ty> && !std_basic_type<Ty> && !std_template_library_type_traits<Ty>::value &&
+                                       (requires { serializer<Ty>::automatic_layout; } || requires { serializer<Ty>::fields(); });
+
+        //////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///                                 Aggregate reflection helpers
+        //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+        // Converts to any member type, counting how many of these initialize an aggregate counts its members.
+        struct any_member_initializer {
+            template <class Ty>
+            constexpr operator Ty() const noexcept;
+        };
+
+        template <class Ty, std::size_t ... I>
+        constexpr bool is_aggregate_initializable_with(std::index_sequence<I...>) {
+            return requires { Ty{(static_cast<void>(I), any_member_initializer{})...}; };
+        }
+
+        // Each initializer in its own braces, so that brace elision can't spread one over the elements of a C array.
+        template <class Ty, std::size_t ... I>
+        constexpr bool is_aggregate_brace_initializable_with(std::index_sequence<I...>) {
+            return requires { Ty{{(static_cast<void>(I), any_member_initializer{})}...}; };
+        }
+
+        inline constexpr std::size_t aggregate_member_limit = 16;
+
+        template <class Ty, std::size_t N = 0>
+        constexpr std::size_t aggregate_member_count() {
+            if constexpr (N < aggregate_member_limit && is_aggregate_initializable_with<Ty>(std::make_index_sequence<N + 1>{})) {
+                return aggregate_member_count<Ty, N + 1>();
+            } else {
+                return N;
+            }
+        }
+
+        template <class Ty, std::size_t N = 0>
+        constexpr std::size_t aggregate_braced_member_count() {
+            if constexpr (N < aggregate_member_limit && is_aggregate_brace_initializable_with<Ty>(std::make_index_sequence<N + 1>{})) {
+                return aggregate_braced_member_count<Ty, N + 1>();
+            } else {
+                return N;
+            }
+        }
+
+        // C array members take one initializer per element by brace elision, so both counts agree only without them
+        // (structured binding sees the array as a single member, and the array itself has no serializer).
+        template <class Ty>
+        constexpr bool aggregate_members_countable() {
+            return aggregate_member_count<Ty>() == aggregate_braced_member_count<Ty>();
+        }
+
+        // Tuple of references to all members of an aggregate.
+        template <class Ty>
+        constexpr auto tie_aggregate(Ty& value) {
+            constexpr std::size_t count = aggregate_member_count<std::remove_const_t<Ty>>();
+#define TIE_AGGREGATE_MEMBERS(n, ...) \
+            if constexpr (count == n) { auto& [__VA_ARGS__] = value; return std::tie(__VA_ARGS__); } else
+            TIE_AGGREGATE_MEMBERS(1,  a)
+            TIE_AGGREGATE_MEMBERS(2,  a, b)
+            TIE_AGGREGATE_MEMBERS(3,  a, b, c)
+            TIE_AGGREGATE_MEMBERS(4,  a, b, c, d)
+            TIE_AGGREGATE_MEMBERS(5,  a, b, c, d, e)
+            TIE_AGGREGATE_MEMBERS(6,  a, b, c, d, e, f)
+            TIE_AGGREGATE_MEMBERS(7,  a, b, c, d, e, f, g)
+            TIE_AGGREGATE_MEMBERS(8,  a, b, c, d, e, f, g, h)
+            TIE_AGGREGATE_MEMBERS(9,  a, b, c, d, e, f, g, h, i)
+            TIE_AGGREGATE_MEMBERS(10, a, b, c, d, e, f, g, h, i, j)
+            TIE_AGGREGATE_MEMBERS(11, a, b, c, d, e, f, g, h, i, j, k)
+            TIE_AGGREGATE_MEMBERS(12, a, b, c, d, e, f, g, h, i, j, k, l)
+            TIE_AGGREGATE_MEMBERS(13, a, b, c, d, e, f, g, h, i, j, k, l, m)
+            TIE_AGGREGATE_MEMBERS(14, a, b, c, d, e, f, g, h, i, j, k, l, m, n)
+            TIE_AGGREGATE_MEMBERS(15, a, b, c, d, e, f, g, h, i, j, k, l, m, n, o)
+            TIE_AGGREGATE_MEMBERS(16, a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)
+            { return std::tuple<>(); }
+#undef TIE_AGGREGATE_MEMBERS
+        }
+
+        // Drops the namespaces (and enclosing classes) of a qualified name, those inside template arguments stay.
+        constexpr std::string_view unqualified_name(std::string_view name) {
+            std::size_t start = 0;
+            int         depth = 0;
+            for (std::size_t i = 0; i < name.size(); ++i) {
+                if      (name[i] == '<') { ++depth; }
+                else if (name[i] == '>') { --depth; }
+                else if (depth == 0 && name[i] == ':' && i + 1 < name.size() && name[i + 1] == ':') { start = i + 2; ++i; }
+            }
+            return name.substr(start);
+        }
+
+        // Unqualified type name from compiler generated function signature, used as type_name of automatic structures.
+        template <class Ty>
+        constexpr std::string_view type_name_of() {
+#if defined(_MSC_VER) && !defined(__clang__)
+            std::string_view f = __FUNCSIG__;
+            f.remove_prefix(f.find("type_name_of<") + 13);
+            f = f.substr(0, f.rfind(">(void)"));
+            if (f.starts_with("struct ")) { f.remove_prefix(7); }
+            if (f.starts_with("class "))  { f.remove_prefix(6); }
+#else
+            std::string_view f = __PRETTY_FUNCTION__;
+            f.remove_prefix(f.find("Ty = ") + 5);
+            f = f.substr(0, f.find_first_of(";]"));
+#endif
+            return unqualified_name(f);
+        }
+
+        // Encoded bytes of this type are exactly its memory, so contiguous ranges of it are copied as one block.
+        template <class Ty>
+        struct binary_layout_compatible : std::bool_constant<std::is_arithmetic_v<Ty>> {};
+
+        template <class Ty, std::size_t N>
+        struct binary_layout_compatible<std::array<Ty, N>> : std::bool_constant<binary_layout_compatible<Ty>::value && sizeof(std::array<Ty, N>) == sizeof(Ty) * N> {};
+
+        // Tuple of references to members of a positional structure in encoding order.
+        template <class Ty>
+        constexpr auto structure_members(Ty& value) {
+            if constexpr (requires { serializer<std::remove_const_t<Ty>>::automatic_layout; }) {
+                return tie_aggregate(value);
+            } else {
+                return std::apply([&](const auto& ... f) {
+                    return std::tie(value.*f.pointer...);
+                }, serializer<std::remove_const_t<Ty>>::fields());
+            }
+        }
+
+        // Only automatic structures have their members encoded in declaration order with nothing else.
+        template <class Ty>
+            requires (std::is_class_v<Ty> && requires { serializer<Ty>::automatic_layout; })
+        struct binary_layout_compatible<Ty> {
+            using members = decltype(tie_aggregate(std::declval<Ty&>()));
+            static constexpr bool value = std::is_trivially_copyable_v<Ty> && []<std::size_t ... I>(std::index_sequence<I...>) {
+                return (binary_layout_compatible<std::remove_reference_t<std::tuple_element_t<I, members>>>::value && ...) &&
+                       (sizeof(std::remove_reference_t<std::tuple_element_t<I, members>>) + ... + 0) == sizeof(Ty);
+            }(std::make_index_sequence<std::tuple_size_v<members>>{});
+        };
+
+        template <class Ty>
+        concept contiguous_binary_range = std::ranges::contiguous_range<Ty> && binary_layout_compatible<std::ranges::range_value_t<Ty>>::value;
+
+        // Temporaries of the reader are constructed with the allocator of their destination container (if any),
+        // so a std::pmr container and everything nested inside it are allocated from the same memory resource.
+        template <class Ty, class Container>
+        constexpr Ty make_element_of(const Container& container) {
+            if constexpr (requires { container.get_allocator(); }) {
+                return std::make_obj_using_allocator<Ty>(container.get_allocator());
+            } else {
+                return Ty{};
+            }
+        }
+
         template <class Ty>
         struct iterate_std_template_stuff_impl {};
 
+        // Counts allocations passing to upstream resource, used by compile statistics.
+        struct counting_memory_resource : std::pmr::memory_resource {
+            std::pmr::memory_resource* upstream;
+            std::size_t                allocations     = 0;
+            std::size_t                allocated_bytes = 0;
+
+            explicit counting_memory_resource(std::pmr::memory_resource* up) : upstream(up) {}
+
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+                ++allocations;
+                allocated_bytes += bytes;
+                return upstream->allocate(bytes, alignment);
+            }
+            void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+                upstream->deallocate(p, bytes, alignment);
+            }
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                return this == &other;
+            }
+        };
+
         template <class ... Args>
         struct iterate_std_template_recursive_helper {};
 
@@ -344,8 +800,20 @@ template <typename K, typename V, typename ... OtherStuff> \
             constexpr auto operator()(std::string::const_iterator& iter, Reader reader, Value& value, int department) {
                 std::invoke(reader, iter, value);
             }
+            template <class Writer> // Binary writer, department separates it from the text formatter.
+            constexpr auto operator()(std::string& buf, Writer writer, const Value& value, int) {
+                std::invoke(writer, buf, value);
+            }
         };
 
+        // Per thread pool of nodes extracted by read_assign, it keeps its capacity between reads. A container can't
+        // contain its own type so nested reads never share it.
+        template <class Node>
+        std::vector<Node>& extracted_node_pool() {
+            static thread_local std::vector<Node> nodes;
+            return nodes;
+        }
+
         template <std_template_library_range STL>
         struct iterate_std_template_stuff_impl<STL> {
             constexpr auto operator()(std::string& buf, bool bin) const {
@@ -377,19 +845,154 @@ template <typename K, typename V, typename ... OtherStuff> \
             constexpr auto operator()(std::string::const_iterator& iter, Reader reader, STL& value, int department) {
                 const std::size_t n = *reinterpret_cast<const std::size_t*>(&*iter);
                 iter += sizeof(std::size_t);
+                if constexpr (requires { reader.flag; }) {
+                    if (reader.flag & read_assign) {
+                        read_assign_elements(iter, reader, value, n, department);
+                        return;
+                    }
+                }
+                if constexpr (contiguous_binary_range<STL> && std_template_library_type_traits<STL>::is_resizeable) {
+                    // Elements are copied as one block.
+                    const std::size_t old = value.size();
+                    value.resize(old + n);
+                    std::memcpy(value.data() + old, &*iter, n * sizeof(typename STL::value_type));
+                    iter += static_cast<std::ptrdiff_t>(n * sizeof(typename STL::value_type));
+                    return;
+                }
                 auto inserter = std::inserter(value, value.end());
                 for (std::size_t i = 0; i != n; ++i) {
                     if constexpr (std_template_library_type_traits<STL>::is_mono) {
-                        typename STL::value_type cache;
+                        auto cache = make_element_of<typename STL::value_type>(value);
                         iterate_std_template_stuff_impl<typename STL::value_type>{}(iter, reader, cache, department);
                         *inserter++ = std::move(cache);
                     }
                     else if constexpr (std_template_library_type_traits<STL>::is_double) {
-                        typename STL::key_type                key;
-                        typename STL::value_type::second_type val;
+                        auto key = make_element_of<typename STL::key_type>(value);
+                        auto val = make_element_of<typename STL::value_type::second_type>(value);
                         iterate_std_template_stuff_impl<typename STL::key_type>{}               (iter, reader, key, department);
                         iterate_std_template_stuff_impl<typename STL::value_type::second_type>{}(iter, reader, val, department);
-                        *inserter++ = std::make_pair(key, val);
+                        *inserter++ = std::make_pair(std::move(key), std::move(val));
+                    }
+                }
+            }
+            // Sequences are resized and their elements read in place, nodes of sets and maps are extracted and refilled.
+            template <class Reader>
+            constexpr void read_assign_elements(std::string::const_iterator& iter, Reader reader, STL& value, std::size_t n, int department) {
+                using traits = std_template_library_type_traits<STL>;
+                if constexpr (traits::is_resizeable) {
+                    value.resize(n);
+                    if constexpr (contiguous_binary_range<STL>) {
+                        std::memcpy(value.data(), &*iter, n * sizeof(typename STL::value_type));
+                        iter += static_cast<std::ptrdiff_t>(n * sizeof(typename STL::value_type));
+                        return;
+                    }
+                    for (auto i = value.begin(); i != value.end(); ++i) {
+                        if constexpr (std::is_same_v<typename STL::value_type, bool>) {
+                            bool b = false;  // std::vector<bool> elements are proxies.
+                            iterate_std_template_stuff_impl<bool>{}(iter, reader, b, department);
+                            *i = b;
+                        } else {
+                            iterate_std_template_stuff_impl<typename STL::value_type>{}(iter, reader, *i, department);
+                        }
+                    }
+                } else {
+                    auto& nodes = extracted_node_pool<typename STL::node_type>();
+                    nodes.clear();
+                    // Capacity is paid for by the first load, so that later ones extract without growing the pool.
+                    nodes.reserve(std::max(n, value.size()));
+                    while (!value.empty()) {
+                        nodes.push_back(value.extract(value.begin()));
+                    }
+                    // Nodes are refilled in their old order so that each one likely gets a value of the same shape.
+                    for (std::size_t i = 0; i != n; ++i) {
+                        if (i >= nodes.size()) {
+                            if constexpr (traits::is_mono) {
+                                auto cache = make_element_of<typename STL::value_type>(value);
+                                iterate_std_template_stuff_impl<typename STL::value_type>{}(iter, reader, cache, department);
+                                value.insert(value.end(), std::move(cache));
+                            } else {
+                                auto key = make_element_of<typename STL::key_type>(value);
+                                auto val = make_element_of<typename STL::mapped_type>(value);
+                                iterate_std_template_stuff_impl<typename STL::key_type>{}   (iter, reader, key, department);
+                                iterate_std_template_stuff_impl<typename STL::mapped_type>{}(iter, reader, val, department);
+                                value.insert(value.end(), std::make_pair(std::move(key), std::move(val)));
+                            }
+                            continue;
+                        }
+                        auto& node = nodes[i];
+                        if constexpr (traits::is_mono) {
+                            iterate_std_template_stuff_impl<typename STL::value_type>{}(iter, reader, node.value(), department);
+                        } else {
+                            iterate_std_template_stuff_impl<typename STL::key_type>{}   (iter, reader, node.key(),    department);
+                            iterate_std_template_stuff_impl<typename STL::mapped_type>{}(iter, reader, node.mapped(), department);
+                        }
+                        value.insert(value.end(), std::move(node));
+                    }
+                    nodes.clear();
+                }
+            }
+            template <class Writer>
+            constexpr auto operator()(std::string& buf, Writer writer, const STL& value, int department) {
+                const std::size_t n = static_cast<std::size_t>(std::ranges::distance(value));
+                buf.append(reinterpret_cast<const char*>(&n), sizeof(std::size_t));
+                if constexpr (contiguous_binary_range<STL>) {
+                    buf.append(reinterpret_cast<const char*>(std::ranges::data(value)), n * sizeof(typename STL::value_type));
+                    return;
+                }
+                for (auto i = value.cbegin(); i != value.cend(); ++i) {
+                    if constexpr (std_template_library_type_traits<STL>::is_mono) {
+                        iterate_std_template_stuff_impl<typename STL::value_type>{}(buf, writer, *i, department);
+                    }
+                    else if constexpr (std_template_library_type_traits<STL>::is_double) {
+                        iterate_std_template_stuff_impl<typename STL::key_type>{}               (buf, writer, i->first,  department);
+                        iterate_std_template_stuff_impl<typename STL::value_type::second_type>{}(buf, writer, i->second, department);
+                    }
+                }
+            }
+        };
+
+        template <typename Ty, std::size_t Extent>
+        struct iterate_std_template_stuff_impl<std::span<Ty, Extent>> {
+            using element = std::remove_const_t<Ty>;
+
+            constexpr auto operator()(std::string& buf, bool bin) const {
+                iterate_std_template_stuff_impl<std::vector<element>>{}(buf, bin);
+            }
+            template <class Formatter>
+            constexpr auto operator()(std::string& buf, Formatter formatter, const std::span<Ty, Extent>& value) {
+                buf.push_back('{');
+                for (const auto& e : value) {
+                    iterate_std_template_stuff_impl<element>{}(buf, formatter, e);
+                }
+                buf.back() = '}';
+                buf.push_back(',');
+            }
+            template <class Reader>
+            constexpr auto operator()(std::string::const_iterator& iter, Reader reader, std::span<Ty, Extent>& value, int department) {
+                static_assert(!std::is_const_v<Ty>, "Can't read into a span of const elements.");
+                const std::size_t n = *reinterpret_cast<const std::size_t*>(&*iter);
+                if (n != value.size()) {
+                    throw std::invalid_argument("Element count doesn't match the span size!");
+                }
+                iter += sizeof(std::size_t);
+                if constexpr (contiguous_binary_range<std::span<Ty, Extent>>) {
+                    std::memcpy(value.data(), &*iter, n * sizeof(Ty));
+                    iter += static_cast<std::ptrdiff_t>(n * sizeof(Ty));
+                } else {
+                    for (auto& e : value) {
+                        iterate_std_template_stuff_impl<element>{}(iter, reader, e, department);
+                    }
+                }
+            }
+            template <class Writer>
+            constexpr auto operator()(std::string& buf, Writer writer, const std::span<Ty, Extent>& value, int department) {
+                const std::size_t n = value.size();
+                buf.append(reinterpret_cast<const char*>(&n), sizeof(std::size_t));
+                if constexpr (contiguous_binary_range<std::span<Ty, Extent>>) {
+                    buf.append(reinterpret_cast<const char*>(value.data()), n * sizeof(Ty));
+                } else {
+                    for (const auto& e : value) {
+                        iterate_std_template_stuff_impl<element>{}(buf, writer, e, department);
                     }
                 }
             }
@@ -419,7 +1022,12 @@ template <typename K, typename V, typename ... OtherStuff> \
             template <class Reader>
             constexpr auto operator()(std::string::const_iterator& iter, Reader reader, std::pair<F, S>& value, int department) {
                 iterate_std_template_stuff_impl<F>{}(iter, reader, value.first, department);
-                iterate_std_template_stuff_impl<F>{}(iter, reader, value.second, department);
+                iterate_std_template_stuff_impl<S>{}(iter, reader, value.second, department);
+            }
+            template <class Writer>
+            constexpr auto operator()(std::string& buf, Writer writer, const std::pair<F, S>& value, int department) {
+                iterate_std_template_stuff_impl<std::remove_cvref_t<F>>{}(buf, writer, value.first,  department);
+                iterate_std_template_stuff_impl<std::remove_cvref_t<S>>{}(buf, writer, value.second, department);
             }
         };
         
@@ -466,6 +1074,12 @@ template <typename K, typename V, typename ... OtherStuff> \
             constexpr auto operator()(std::string::const_iterator& iter, Reader reader, std::array<Ty, N>& value, int department) {
                 read_array(iter, reader, value, department);
             }
+            template <class Writer>
+            constexpr auto operator()(std::string& buf, Writer writer, const std::array<Ty, N>& value, int department) {
+                for (auto& i : value) {
+                    iterate_std_template_stuff_impl<Ty>{}(buf, writer, i, department);
+                }
+            }
         };
 
         template <class ... Args>
@@ -506,6 +1120,46 @@ template <typename K, typename V, typename ... OtherStuff> \
             constexpr auto operator()(std::string::const_iterator& iter, Reader reader, std::tuple<Args...>& value, int department) {
                 read_tuple(iter, reader, value, department);
             }
+            template <class Writer>
+            constexpr auto operator()(std::string& buf, Writer writer, const std::tuple<Args...>& value, int department) {
+                std::apply([&](const auto& ... i) {
+                    (iterate_std_template_stuff_impl<std::remove_cvref_t<decltype(i)>>{}(buf, writer, i, department), ...);
+                }, value);
+            }
+        };
+
+        // Structures inside containers are written as std::tuple of their members, both forms encode the same bytes.
+        template <positional_structure Structure>
+        struct iterate_std_template_stuff_impl<Structure> {
+            using members = decltype(structure_members(std::declval<Structure&>()));
+            using tuple   = decltype([]<std::size_t ... I>(std::index_sequence<I...>) {
+                return std::tuple<std::remove_cvref_t<std::tuple_element_t<I, members>>...>{};
+            }(std::make_index_sequence<std::tuple_size_v<members>>{}));
+
+            constexpr auto operator()(std::string& buf, bool bin) const {
+                iterate_std_template_stuff_impl<tuple>{}(buf, bin);
+            }
+            template <class Formatter>
+            constexpr auto operator()(std::string& buf, Formatter formatter, const Structure& value) {
+                buf.push_back('{');
+                std::apply([&](const auto& ... m) {
+                    (iterate_std_template_stuff_impl<std::remove_cvref_t<decltype(m)>>{}(buf, formatter, m), ...);
+                }, structure_members(value));
+                buf.back() = '}';
+                buf.push_back(',');
+            }
+            template <class Reader>
+            constexpr auto operator()(std::string::const_iterator& iter, Reader reader, Structure& value, int department) {
+                std::apply([&](auto& ... m) {
+                    (iterate_std_template_stuff_impl<std::remove_cvref_t<decltype(m)>>{}(iter, reader, m, department), ...);
+                }, structure_members(value));
+            }
+            template <class Writer>
+            constexpr auto operator()(std::string& buf, Writer writer, const Structure& value, int department) {
+                std::apply([&](const auto& ... m) {
+                    (iterate_std_template_stuff_impl<std::remove_cvref_t<decltype(m)>>{}(buf, writer, m, department), ...);
+                }, structure_members(value));
+            }
         };
         
     }
@@ -537,9 +1191,81 @@ template <typename K, typename V, typename ... OtherStuff> \
         return buf;
     }
 
+    namespace details {
+
+        // Containers with at least this many elements are formatted by multiple threads.
+        inline constexpr std::size_t parallel_text_threshold = 1 << 16;
+
+        // Formats elements of a large container in chunks on all hardware threads and splices the chunks in order,
+        // output is the same as iterate_std_template_stuff_impl. Returns false without doing anything for small ones.
+        // Only containers which know their size (so not std::forward_list) are split.
+        template <std_template_library_range STL, class Formatter>
+            requires std::ranges::sized_range<STL>
+        bool format_range_concurrently(std::string& buf, Formatter formatter, const STL& value,
+                                       std::size_t thread_count = std::thread::hardware_concurrency()) {
+            if (std::ranges::size(value) < parallel_text_threshold || thread_count < 2) {
+                return false;
+            }
+            const std::size_t n           = static_cast<std::size_t>(std::ranges::size(value));
+            const std::size_t chunk_count = thread_count * 4;
+            const std::size_t chunk       = (n + chunk_count - 1) / chunk_count;
+            std::vector<std::ranges::iterator_t<const STL>> firsts;
+            for (auto i = std::ranges::begin(value); i != std::ranges::end(value); i = std::ranges::next(i, chunk, std::ranges::end(value))) {
+                firsts.push_back(i);
+            }
+            firsts.push_back(std::ranges::end(value));
+
+            std::vector<std::string> parts(firsts.size() - 1);
+            std::atomic<std::size_t> next_chunk = 0;
+            std::exception_ptr       error;
+            std::atomic_flag         error_set;
+            auto worker = [&] {
+                try {
+                    for (std::size_t c = next_chunk++; c < parts.size(); c = next_chunk++) {
+                        for (auto i = firsts[c]; i != firsts[c + 1]; ++i) {
+                            iterate_std_template_stuff_impl<typename STL::value_type>{}(parts[c], formatter, *i);
+                        }
+                    }
+                } catch (...) {
+                    if (!error_set.test_and_set()) {
+                        error = std::current_exception();
+                    }
+                }
+            };
+            {
+                std::vector<std::jthread> workers;
+                for (std::size_t i = 1; i < std::min(thread_count, parts.size()); ++i) {
+                    workers.emplace_back(worker);
+                }
+                worker();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            std::size_t size = 2;
+            for (auto& part : parts) {
+                size += part.size();
+            }
+            buf.reserve(buf.size() + size);
+            buf.push_back('{');
+            for (auto& part : parts) {
+                buf.append(part);
+            }
+            buf.back() = '}';
+            buf.push_back(',');
+            return true;
+        }
+    }
+
     template <typename Ty, class Formatter>
     constexpr auto std_type_value_string(const Ty& value, Formatter formatter) {
         std::string buffer;
+        if constexpr (details::std_template_library_range<Ty> && std::ranges::sized_range<Ty>) {
+            if (!std::is_constant_evaluated() && details::format_range_concurrently(buffer, formatter, value)) {
+                buffer.back() = ';';
+                return buffer;
+            }
+        }
         details::iterate_std_template_stuff_impl<Ty>{}(buffer, formatter, value);
         buffer.back() = ';';
         return buffer;
@@ -548,14 +1274,6 @@ template <typename K, typename V, typename ... OtherStuff> \
     template <class Ty>
     constexpr auto std_text_value_of(const Ty& value);
 
-    typedef enum std_basic_io_flag{
-        integer_binary            = 1 << 1,
-        integer_heximal           = 1 << 2,
-        floating_point_fixed      = 1 << 3,
-        floating_point_scientific = 1 << 4,
-        string_use_raw            = 1 << 5,
-    } std_basic_io_flag;
-
     struct std_basic_type_text_output_formatter {
         flag_t flag{};
         
@@ -579,7 +1297,7 @@ template <typename K, typename V, typename ... OtherStuff> \
                         case '\f': cache.append("\\f");     break;
                         case '\a': cache.append("\\a");     break;
                         case '\"': cache.append("\\\"");    break;
-                        case '\\': cache.append("\\");      break;
+                        case '\\': cache.append("\\\\");    break;
                         }
                     }
                     buf.push_back('\"');
@@ -612,6 +1330,36 @@ template <typename K, typename V, typename ... OtherStuff> \
         }
     };
 
+    namespace details {
+
+        // String table of an archive, it's a std::vector<std::string> block with a sub-index of stride 1
+        // so that string i is found directly.
+        struct string_table_view {
+            const char* value   = nullptr;  // Value begin of the table block.
+            const char* entries = nullptr;  // Sub-index entries.
+            std::size_t count   = 0;
+
+            std::string_view operator[](std::size_t i) const {
+                std::size_t offset = 0;
+                std::memcpy(&offset, entries + i * sizeof(std::size_t), sizeof(std::size_t));
+                return std::string_view(value + offset);
+            }
+        };
+
+        // Table used by readers of the current thread, set while a block with interned strings is decoded,
+        // so that every serializer (custom ones too) decodes interned strings without knowing about them.
+        inline thread_local const string_table_view* current_string_table = nullptr;
+
+        struct string_table_scope {
+            const string_table_view* previous;
+            explicit string_table_scope(const string_table_view* table) : previous(current_string_table) {
+                current_string_table = table;
+            }
+            ~string_table_scope() { current_string_table = previous; }
+            string_table_scope(const string_table_scope&) = delete;
+        };
+    }
+
     struct std_basic_type_binary_input_reader {
         flag_t flag{};
         
@@ -622,41 +1370,731 @@ template <typename K, typename V, typename ... OtherStuff> \
                 iter += sizeof(Ty);
             }
             else if constexpr (details::std_string_type_traits<Ty>::value) {
+                // Interned strings are shared, string_view refers to the archive content directly.
+                if (const details::string_table_view* table = details::current_string_table) {
+                    std::uint32_t index = 0;
+                    std::memcpy(&index, &*iter, sizeof(std::uint32_t));
+                    iter += sizeof(std::uint32_t);
+                    if constexpr (details::std_string_type_traits<Ty>::is_view) {
+                        value = Ty((*table)[index]);
+                    } else {
+                        value.assign((*table)[index]);
+                    }
+                    return;
+                }
                 if constexpr (details::std_string_type_traits<Ty>::is_view) {
                     throw std::invalid_argument("Reader can not accept a string_view");
+                } else {
+                    const std::size_t len = std::strlen(&*iter);
+                    value.resize(len);
+                    std::memcpy(value.data(), &*iter, len);
+                    iter += static_cast<std::ptrdiff_t>(len + 1);
                 }
-                const std::size_t len = std::strlen(&*iter);
-                value.resize(len);
-                std::memcpy(value.data(), &*iter, len);
-                iter += static_cast<std::ptrdiff_t>(len + 1);
             }
         }
         
     };
 
+    // Writes values just like the compiler does, so binary can be produced without text.
+    struct std_basic_type_binary_output_writer {
+        flag_t flag{};
+
+        template <details::std_basic_type Ty>
+        constexpr void operator()(std::string& buf, const Ty& value) {
+            if constexpr (std::is_arithmetic_v<Ty>) {
+                buf.append(reinterpret_cast<const char*>(&value), sizeof(Ty));
+            }
+            else if constexpr (details::std_string_type_traits<Ty>::value) {
+                buf.append(value.data(), value.size());
+                buf.push_back('\0');
+            }
+        }
+    };
+
     //////////////////////////////////////////////////////////////////////////////////////////////
-    ///                               Compiler Implementation
+    ///                               Binary type signature
     //////////////////////////////////////////////////////////////////////////////////////////////
-    
-    struct cpp_subset_compiler {
-        std::string src;
-        std::string msg;
-        std::string out;
-        
-        static constexpr std::string_view keywords[255] = {
-            "int8_t",       "uint8_t",   "int16_t",        "uint16_t",
-            "int",          "uint32_t",  "int64_t",        "uint64_t",
-            "float",        "double",    "bool",           "std::string",    
-            // Containers.
-            "std::vector", "std::deque",  "std::list", "std::forward_list", "std::hive", "std::set", "std::multiset",
-            "std::unordered_set", "std::unordered_multiset", "std::map", "std::multimap", "std::unordered_map", "std::unordered_multimap",
-            "std::pair",           "std::array",             "std::tuple",
-            
-            // Structure.
-            "struct", "class"
-        };
 
-        static constexpr std::string_view operators[] = {
+    namespace details {
+
+        // Parsed form of a binary type signature, so that values can be walked without knowing their C++ types.
+        struct binary_type_node {
+            std::uint8_t                  identifier = 0;  // 1-28 or 0xFF (structure).
+            std::size_t                   extent     = 0;  // Size of std::array.
+            std::string_view              name;            // Type name of structure.
+            std::vector<binary_type_node> arguments;
+        };
+
+        // Parses one type of signature from [p, end) and moves p forward, returns false on malformed signature.
+        inline bool parse_binary_type_node(const char*& p, const char* end, binary_type_node& node, std::size_t depth = 0) {
+            if (p == end || depth > 64) {
+                return false;
+            }
+            node.identifier = static_cast<std::uint8_t>(*p++);
+            if (node.identifier >= 1 && node.identifier <= 12) {
+                return true;
+            }
+            if (node.identifier == 0xFF) {
+                const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p));
+                if (e == nullptr) {
+                    return false;
+                }
+                node.name = std::string_view(p, e - p);
+                p = e + 1;
+                return true;
+            }
+            if (node.identifier < 13 || node.identifier > 28 || node.identifier == 17 || p == end || *p++ != '<') {
+                return false;
+            }
+            for (;;) {
+                if (!parse_binary_type_node(p, end, node.arguments.emplace_back(), depth + 1) || p == end) {
+                    return false;
+                }
+                if (node.identifier == 27) {
+                    // std::array<Ty, N> has its element followed by ',' and raw N.
+                    if (*p++ != ',' || end - p < static_cast<std::ptrdiff_t>(sizeof(std::size_t) + 1)) {
+                        return false;
+                    }
+                    std::memcpy(&node.extent, p, sizeof(std::size_t));
+                    p += sizeof(std::size_t);
+                }
+                if (*p == '>') {
+                    ++p;
+                    break;
+                }
+                if (*p++ != ',') {
+                    return false;
+                }
+            }
+            const std::size_t argc = node.arguments.size();
+            if ((node.identifier < 22 && argc != 1) || (node.identifier > 21 && node.identifier < 27 && argc != 2) || (node.identifier == 27 && argc != 1)) {
+                return false;
+            }
+            return true;
+        }
+
+        // Parses a whole signature of an offset block, p is moved to the variable name.
+        inline bool parse_binary_type_signature(const char*& p, const char* end, binary_type_node& node) {
+            if (!parse_binary_type_node(p, end, node)) {
+                return false;
+            }
+            // Structure name is already terminated, standard types have a trailing zero.
+            if (node.identifier != 0xFF) {
+                if (p == end || *p++ != '\0') {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Size of encoded value if it is fixed, otherwise zero. Interned strings are fixed size indices.
+        inline std::size_t binary_fixed_size(const binary_type_node& node, bool interned = false) {
+            static constexpr std::size_t basic_sizes[] = {0, 1, 1, 2, 2, sizeof(int), 4, 8, 8, sizeof(float), sizeof(double), sizeof(bool)};
+            if (node.identifier < 12) {
+                return basic_sizes[node.identifier];
+            }
+            if (node.identifier == 12) {
+                return interned ? sizeof(std::uint32_t) : 0;
+            }
+            if (node.identifier == 27) {
+                return node.extent * binary_fixed_size(node.arguments[0], interned);
+            }
+            if (node.identifier == 26 || node.identifier == 28) {
+                std::size_t n = 0;
+                for (auto& a : node.arguments) {
+                    const std::size_t k = binary_fixed_size(a, interned);
+                    if (k == 0) {
+                        return 0;
+                    }
+                    n += k;
+                }
+                return n;
+            }
+            return 0;
+        }
+
+        // Least possible size of encoded value, used for hoisted container size checks.
+        inline std::size_t binary_minimum_size(const binary_type_node& node, bool interned = false) {
+            if (const std::size_t n = binary_fixed_size(node, interned); n != 0) {
+                return n;
+            }
+            switch (node.identifier) {
+            case 12: return 1;
+            case 27: return node.extent * binary_minimum_size(node.arguments[0], interned);
+            case 26: case 28: {
+                std::size_t n = 0;
+                for (auto& a : node.arguments) {
+                    n += binary_minimum_size(a, interned);
+                }
+                return n;
+            }
+            default: return sizeof(std::size_t);
+            }
+        }
+
+        // Bool and interned strings are the fixed size types whose bytes are not all valid values.
+        inline bool binary_needs_walk(const binary_type_node& node, bool interned = false) {
+            return node.identifier == 11 || (interned && node.identifier == 12) ||
+                std::any_of(node.arguments.begin(), node.arguments.end(), [&](auto& a) { return binary_needs_walk(a, interned); });
+        }
+
+        // Returns end of the value starting at p, or nullptr if the value is malformed or runs out of end.
+        // Each container checks 'count * minimum element size' against the remaining bytes once,
+        // then elements of fixed size are skipped as a whole instead of being walked one by one.
+        // Elements of minimum size zero are encoded with no bytes at all, so their count costs nothing.
+        // Strings are indices checked against strings when it is not null.
+        inline const char* walk_binary_value(const binary_type_node& node, const char* p, const char* end,
+                                             const string_table_view* strings = nullptr) {
+            const bool        interned = strings != nullptr;
+            const std::size_t fixed    = binary_fixed_size(node, interned);
+            if (fixed != 0 && !binary_needs_walk(node, interned)) {
+                return static_cast<std::size_t>(end - p) < fixed ? nullptr : p + fixed;
+            }
+            switch (node.identifier) {
+            case 11:
+                return (p != end && static_cast<unsigned char>(*p) < 2) ? p + 1 : nullptr;
+            case 12: {
+                if (interned) {
+                    std::uint32_t index = 0;
+                    if (static_cast<std::size_t>(end - p) < sizeof(index)) {
+                        return nullptr;
+                    }
+                    std::memcpy(&index, p, sizeof(index));
+                    return index < strings->count ? p + sizeof(index) : nullptr;
+                }
+                const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p));
+                return e == nullptr ? nullptr : e + 1;
+            }
+            case 26: case 28:
+                for (auto& a : node.arguments) {
+                    if ((p = walk_binary_value(a, p, end, strings)) == nullptr) {
+                        return nullptr;
+                    }
+                }
+                return p;
+            case 27:
+                for (std::size_t i = 0; i != node.extent; ++i) {
+                    if ((p = walk_binary_value(node.arguments[0], p, end, strings)) == nullptr) {
+                        return nullptr;
+                    }
+                }
+                return p;
+            case 0xFF:
+                return nullptr; // Fields of structure are not recorded in its signature.
+            default: break;
+            }
+            // Containers.
+            if (static_cast<std::size_t>(end - p) < sizeof(std::size_t)) {
+                return nullptr;
+            }
+            std::size_t n = 0;
+            std::memcpy(&n, p, sizeof(std::size_t));
+            p += sizeof(std::size_t);
+            std::size_t element_minimum = 0;
+            for (auto& a : node.arguments) {
+                element_minimum += binary_minimum_size(a, interned);
+            }
+            if (element_minimum == 0) {
+                return p; // Elements such as std::array<T, 0> take no bytes, any count is skipped at once.
+            }
+            if (n > static_cast<std::size_t>(end - p) / element_minimum) {
+                return nullptr;
+            }
+            if (node.arguments.size() == 1) {
+                const auto& element = node.arguments[0];
+                if (const std::size_t k = binary_fixed_size(element, interned); k != 0 && !binary_needs_walk(element, interned)) {
+                    return p + n * k;
+                }
+            }
+            for (std::size_t i = 0; i != n; ++i) {
+                for (auto& a : node.arguments) {
+                    if ((p = walk_binary_value(a, p, end, strings)) == nullptr) {
+                        return nullptr;
+                    }
+                }
+            }
+            return p;
+        }
+
+        // Text names of signature identifiers, index is the identifier.
+        inline constexpr std::string_view binary_type_names[] = {
+            "",              "int8_t",             "uint8_t",       "int16_t",            "uint16_t",
+            "int",           "uint32_t",           "int64_t",       "uint64_t",           "float",
+            "double",        "bool",               "std::string",   "std::vector",        "std::deque",
+            "std::list",     "std::forward_list",  "",              "std::set",           "std::multiset",
+            "std::unordered_set", "std::unordered_multiset",        "std::map",           "std::multimap",
+            "std::unordered_map", "std::unordered_multimap",        "std::pair",          "std::array",
+            "std::tuple"
+        };
+
+        // Headers the text form needs for an identifier.
+        inline constexpr std::string_view binary_type_headers[] = {
+            "",        "cstdint",       "cstdint", "cstdint",       "cstdint", "",          "cstdint", "cstdint",
+            "cstdint", "",              "",        "",              "string",  "vector",    "deque",   "list",
+            "forward_list", "",         "set",     "set",           "unordered_set", "unordered_set", "map", "map",
+            "unordered_map", "unordered_map", "utility", "array",   "tuple"
+        };
+
+        // Marks every identifier used by the signature.
+        template <std::size_t N>
+        void binary_type_identifiers(const binary_type_node& node, bool (&used)[N]) {
+            if (node.identifier < N) {
+                used[node.identifier] = true;
+                for (auto& a : node.arguments) {
+                    binary_type_identifiers(a, used);
+                }
+            }
+        }
+
+        inline void binary_type_text(const binary_type_node& node, std::string& buf) {
+            buf.append(binary_type_names[node.identifier]);
+            if (node.identifier <= 12) {
+                return;
+            }
+            buf.push_back('<');
+            for (auto& a : node.arguments) {
+                binary_type_text(a, buf);
+                buf.push_back(',');
+            }
+            if (node.identifier == 27) {
+                buf.append(std::to_string(node.extent)).push_back('>');
+            } else {
+                buf.back() = '>';
+            }
+        }
+
+        // Calls visit(field_offset, type, path) for every entry of the field directory of a block whose value starts at
+        // name_end + 1, returns false if the directory is malformed. Entries come in declaration order, a nested
+        // structure is followed by its fields.
+        template <class Visit>
+        bool visit_field_directory(const char* name_end, const char* block_end, Visit&& visit) {
+            constexpr std::size_t word = sizeof(std::size_t);
+            std::size_t directory_size = 0;
+            if (static_cast<std::size_t>(block_end - name_end - 1) < word ||
+                (std::memcpy(&directory_size, block_end - word, word), directory_size > static_cast<std::size_t>(block_end - name_end - 1) - word)) {
+                return false;
+            }
+            const char* const directory_end = block_end - word;
+            for (const char* e = directory_end - directory_size; e != directory_end;) {
+                std::size_t      field = 0;
+                binary_type_node type;
+                const char*      path_end = nullptr;
+                if (static_cast<std::size_t>(directory_end - e) < word) {
+                    return false;
+                }
+                std::memcpy(&field, e, word);
+                e += word;
+                if (!parse_binary_type_signature(e, directory_end, type) ||
+                    (path_end = static_cast<const char*>(std::memchr(e, '\0', directory_end - e))) == nullptr) {
+                    return false;
+                }
+                visit(field, type, std::string_view(e, path_end - e));
+                e = path_end + 1;
+            }
+            return true;
+        }
+
+        // Trailers of the block at 'block' rebuilt for its new value: a field directory keeps its entries with offsets
+        // walked again over value using their recorded types, a sub-index keeps its stride. They are appended to value
+        // and their flags are returned, zero when value no longer matches them (then they are dropped).
+        inline std::size_t rebuild_block_trailers(const char* block, std::string& value) {
+            constexpr std::size_t word = sizeof(std::size_t);
+            std::size_t offset = 0;
+            std::memcpy(&offset, block, word);
+            const char* const block_end = block + word + (offset & ~offset_block_flag_mask);
+            const char*       p         = block + word;
+            binary_type_node  type;
+            if (!parse_binary_type_signature(p, block_end, type)) {
+                return 0;
+            }
+            const char* const name_end = static_cast<const char*>(std::memchr(p, '\0', block_end - p));
+            const char* const begin    = value.data();
+            const char* const end      = value.data() + value.size();
+            if ((offset & offset_block_has_sub_index) && type.identifier > 12 && type.identifier < 17 && value.size() >= word) {
+                std::size_t stride = 0, n = 0;
+                std::memcpy(&stride, block_end - word, word);
+                std::memcpy(&n, begin, word);
+                std::string index;
+                const char* e = begin + word;
+                for (std::size_t i = 0; i != n && e != nullptr; ++i) {
+                    if (i % stride == 0) {
+                        const std::size_t o = static_cast<std::size_t>(e - begin);
+                        index.append(reinterpret_cast<const char*>(&o), word);
+                    }
+                    e = walk_binary_value(type.arguments[0], e, end);
+                }
+                const std::size_t count = index.size() / word;
+                if (e != end || count < 2) {
+                    return 0;
+                }
+                value.append(index);
+                value.append(reinterpret_cast<const char*>(&count), word);
+                value.append(reinterpret_cast<const char*>(&stride), word);
+                return offset_block_has_sub_index;
+            }
+            if ((offset & offset_block_has_field_directory) && type.identifier == 0xFF && name_end != nullptr) {
+                std::size_t directory_size = 0;
+                std::memcpy(&directory_size, block_end - word, word);
+                std::string directory;
+                const char* entry = block_end - word - directory_size;
+                const char* e     = begin;
+                const bool  sound = visit_field_directory(name_end, block_end, [&](std::size_t, const binary_type_node& field_type, std::string_view path) {
+                    const char* const entry_end = path.data() + path.size() + 1;
+                    if (e != nullptr) {
+                        const std::size_t o = static_cast<std::size_t>(e - begin);
+                        directory.append(reinterpret_cast<const char*>(&o), word).append(entry + word, entry_end);
+                        if (field_type.identifier != 0xFF) {
+                            e = walk_binary_value(field_type, e, end);
+                        }
+                    }
+                    entry = entry_end;
+                });
+                if (!sound || e != end) {
+                    return 0;
+                }
+                directory_size = directory.size();
+                value.append(directory);
+                value.append(reinterpret_cast<const char*>(&directory_size), word);
+                return offset_block_has_field_directory;
+            }
+            return 0;
+        }
+
+        // Writes text form of values using their signatures, text is handed to sink whenever the buffer grows beyond
+        // flush_size so memory stays bounded no matter how large a single value is.
+        template <class Sink>
+        struct binary_value_decompiler {
+            static constexpr std::size_t flush_size = 1 << 16;
+
+            Sink&                                sink;
+            std_basic_type_text_output_formatter formatter;
+            std::string                          buf{};
+            const string_table_view*             strings = nullptr;  // Set while a block with interned strings is written.
+
+            void flush() {
+                if (!buf.empty()) {
+                    std::invoke(sink, std::string_view(buf));
+                    buf.clear();
+                }
+            }
+
+            template <class Ty>
+            const char* arithmetic(const char* p, const char* end) {
+                if (static_cast<std::size_t>(end - p) < sizeof(Ty)) {
+                    return nullptr;
+                }
+                Ty value;
+                std::memcpy(&value, p, sizeof(Ty));
+                formatter(buf, value);
+                return p + sizeof(Ty);
+            }
+
+            // Returns end of the value or nullptr if it's malformed.
+            const char* value(const binary_type_node& node, const char* p, const char* end) {
+                switch (node.identifier) {
+                case 1:  return arithmetic<std::int8_t>  (p, end);
+                case 2:  return arithmetic<std::uint8_t> (p, end);
+                case 3:  return arithmetic<std::int16_t> (p, end);
+                case 4:  return arithmetic<std::uint16_t>(p, end);
+                case 5:  return arithmetic<int>          (p, end);
+                case 6:  return arithmetic<std::uint32_t>(p, end);
+                case 7:  return arithmetic<std::int64_t> (p, end);
+                case 8:  return arithmetic<std::uint64_t>(p, end);
+                case 9:  return arithmetic<float>        (p, end);
+                case 10: return arithmetic<double>       (p, end);
+                case 11:
+                    if (p == end || static_cast<unsigned char>(*p) > 1) {
+                        return nullptr;
+                    }
+                    formatter(buf, *p == 1);
+                    return p + 1;
+                case 12: {
+                    if (strings != nullptr) {
+                        std::uint32_t index = 0;
+                        if (static_cast<std::size_t>(end - p) < sizeof(index) || (std::memcpy(&index, p, sizeof(index)), index >= strings->count)) {
+                            return nullptr;
+                        }
+                        formatter(buf, (*strings)[index]);
+                        return p + sizeof(index);
+                    }
+                    const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p));
+                    if (e == nullptr) {
+                        return nullptr;
+                    }
+                    formatter(buf, std::string_view(p, e - p));
+                    return e + 1;
+                }
+                case 0xFF:
+                    return nullptr;
+                default: break;
+                }
+                std::size_t n = node.extent;
+                if (node.identifier == 26 || node.identifier == 28) {
+                    n = 1;
+                } else if (node.identifier != 27) {
+                    if (static_cast<std::size_t>(end - p) < sizeof(std::size_t)) {
+                        return nullptr;
+                    }
+                    std::memcpy(&n, p, sizeof(std::size_t));
+                    p += sizeof(std::size_t);
+                }
+                const bool is_map = node.identifier >= 22 && node.identifier <= 25;
+                buf.push_back('{');
+                for (std::size_t i = 0; i != n; ++i) {
+                    if (i != 0) {
+                        buf.push_back(',');
+                    }
+                    if (is_map) {
+                        buf.push_back('{');
+                    }
+                    for (std::size_t k = 0; k != node.arguments.size(); ++k) {
+                        if (k != 0) {
+                            buf.push_back(',');
+                        }
+                        if ((p = value(node.arguments[k], p, end)) == nullptr) {
+                            return nullptr;
+                        }
+                    }
+                    if (is_map) {
+                        buf.push_back('}');
+                    }
+                    if (buf.size() >= flush_size) {
+                        flush();
+                    }
+                }
+                buf.push_back('}');
+                return p;
+            }
+        };
+    }
+
+    namespace details {
+
+        // CRC32C (Castagnoli) slicing-by-8 tables, used when the crc32 instruction isn't enabled.
+        inline constexpr auto crc32c_tables = [] {
+            std::array<std::array<std::uint32_t, 256>, 8> t{};
+            for (std::uint32_t i = 0; i != 256; ++i) {
+                std::uint32_t c = i;
+                for (int k = 0; k != 8; ++k) {
+                    c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+                }
+                t[0][i] = c;
+            }
+            for (std::size_t i = 0; i != 256; ++i) {
+                for (std::size_t j = 1; j != 8; ++j) {
+                    t[j][i] = (t[j - 1][i] >> 8) ^ t[0][t[j - 1][i] & 0xFF];
+                }
+            }
+            return t;
+        }();
+
+        // Continues crc (zero to start) over [data, data + size).
+        inline std::uint32_t crc32c(std::uint32_t crc, const char* data, std::size_t size) noexcept {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+            crc = ~crc;
+#if defined(__SSE4_2__)
+            for (; size >= 8; p += 8, size -= 8) {
+                std::uint64_t v = 0;
+                std::memcpy(&v, p, 8);
+                crc = static_cast<std::uint32_t>(_mm_crc32_u64(crc, v));
+            }
+            for (; size != 0; ++p, --size) {
+                crc = _mm_crc32_u8(crc, *p);
+            }
+#elif defined(__ARM_FEATURE_CRC32)
+            for (; size >= 8; p += 8, size -= 8) {
+                std::uint64_t v = 0;
+                std::memcpy(&v, p, 8);
+                crc = __crc32cd(crc, v);
+            }
+            for (; size != 0; ++p, --size) {
+                crc = __crc32cb(crc, *p);
+            }
+#else
+            const auto& t = crc32c_tables;
+            for (; size >= 8; p += 8, size -= 8) {
+                const std::uint32_t lo = (p[0] | p[1] << 8 | p[2] << 16 | static_cast<std::uint32_t>(p[3]) << 24) ^ crc;
+                const std::uint32_t hi =  p[4] | p[5] << 8 | p[6] << 16 | static_cast<std::uint32_t>(p[7]) << 24;
+                crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                      t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+            }
+            for (; size != 0; ++p, --size) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+            }
+#endif
+            return ~crc;
+        }
+
+        // Where the checksum of the block is (or goes), null if its trailers are malformed. Body is what follows the
+        // offset word, up to body_end.
+        inline const char* block_checksum(const char* body, const char* body_end, std::size_t offset) noexcept {
+            constexpr std::size_t word = sizeof(std::size_t);
+            const char* e = body_end;
+            if (offset & offset_block_has_field_directory) {
+                std::size_t size = 0;
+                if (static_cast<std::size_t>(e - body) < word ||
+                    (std::memcpy(&size, e - word, word), size > static_cast<std::size_t>(e - body) - word)) {
+                    return nullptr;
+                }
+                e -= size + word;
+            }
+            if (offset & offset_block_has_sub_index) {
+                std::size_t count = 0;
+                if (static_cast<std::size_t>(e - body) < word * 2 ||
+                    (std::memcpy(&count, e - word * 2, word), count > static_cast<std::size_t>(e - body) / word - 2)) {
+                    return nullptr;
+                }
+                e -= (count + 2) * word;
+            }
+            if (static_cast<std::size_t>(e - body) < sizeof(std::uint32_t)) {
+                return nullptr;
+            }
+            return e - sizeof(std::uint32_t);
+        }
+
+        inline bool verify_block_checksum(const char* body, const char* body_end, std::size_t offset) noexcept {
+            const char* const c = block_checksum(body, body_end, offset);
+            if (c == nullptr) {
+                return false;
+            }
+            std::uint32_t stored = 0;
+            std::memcpy(&stored, c, sizeof(std::uint32_t));
+            const char* const rest = c + sizeof(std::uint32_t);
+            std::uint32_t crc = crc32c(0, reinterpret_cast<const char*>(&offset), sizeof(std::size_t));
+            crc = crc32c(crc32c(crc, body, c - body), rest, body_end - rest);
+            return crc == stored;
+        }
+
+        // Gives the block at head of buf (which has no checksum yet) a checksum.
+        template <class String>
+        void seal_block(String& buf, std::size_t head) {
+            constexpr std::size_t word = sizeof(std::size_t);
+            std::size_t offset = 0;
+            std::memcpy(&offset, buf.data() + head, word);
+            const std::size_t block_end = head + word + (offset & ~offset_block_flag_mask);
+            const std::size_t at        = static_cast<std::size_t>(block_checksum(buf.data() + head + word, buf.data() + block_end, offset) -
+                                                                   buf.data()) + sizeof(std::uint32_t);
+            offset = (offset + sizeof(std::uint32_t)) | offset_block_has_checksum;
+            std::memcpy(buf.data() + head, &offset, word);
+            buf.insert(at, sizeof(std::uint32_t), '\0');
+            const std::uint32_t crc = crc32c(crc32c(0, buf.data() + head, at - head), buf.data() + at + sizeof(std::uint32_t),
+                                             block_end - at);
+            std::memcpy(buf.data() + at, &crc, sizeof(std::uint32_t));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////
+    ///                               Compiler Implementation
+    //////////////////////////////////////////////////////////////////////////////////////////////
+
+    namespace details {
+
+        // Finds where top level declarations and preprocessor lines end in text arriving piece by piece,
+        // state is kept between calls so text may be cut anywhere.
+        struct declaration_scanner {
+            enum class state { code, line_comment, block_comment, string, raw_string, directive };
+
+            state       current    = state::code;
+            std::size_t depth      = 0;
+            bool        line_begin = true;
+            bool        has_code   = false;   // Anything but spaces and comments since the last piece.
+            bool        misplaced  = false;   // Directive found inside a declaration.
+
+            // Returns end of the next complete piece after 'from' or npos if more text is needed, 'directive' tells
+            // which kind it is. Two characters of lookahead are needed unless eof. 'from' is updated to where to resume.
+            std::size_t scan(std::string_view text, std::size_t& from, bool eof, bool& directive) {
+                auto at = [&](std::size_t i) { return i < text.size() ? text[i] : '\0'; };
+                std::size_t i = from;
+                for (; eof ? i < text.size() : i + 2 < text.size(); ++i) {
+                    const char c = text[i];
+                    switch (current) {
+                    case state::line_comment:
+                        if (c == '\n') { current = state::code; line_begin = true; }
+                        continue;
+                    case state::block_comment:
+                        if (c == '*' && at(i + 1) == '/') { current = state::code; ++i; }
+                        continue;
+                    case state::string:
+                        if (c == '\\') { ++i; }
+                        else if (c == '\"') { current = state::code; }
+                        continue;
+                    case state::raw_string:
+                        if (c == ')' && at(i + 1) == '\"') { current = state::code; ++i; }
+                        continue;
+                    case state::directive:
+                        if (c == '\n' && at(i - 1) != '\\') {
+                            current    = state::code;
+                            line_begin = true;
+                            from       = i + 1;
+                            directive  = true;
+                            return i + 1;
+                        }
+                        continue;
+                    case state::code: break;
+                    }
+                    if (c == '/' && at(i + 1) == '/') { current = state::line_comment; ++i; continue; }
+                    if (c == '/' && at(i + 1) == '*') { current = state::block_comment; ++i; continue; }
+                    if (c == '\n') { line_begin = true; continue; }
+                    if (std::isspace(static_cast<unsigned char>(c))) { continue; }
+                    if (c == '#' && line_begin) {
+                        if (has_code) {
+                            from      = i;
+                            misplaced = true;
+                            return std::string_view::npos;
+                        }
+                        current = state::directive;
+                        continue;
+                    }
+                    line_begin = false;
+                    has_code   = true;
+                    if (c == 'R' && at(i + 1) == '\"' && at(i + 2) == '(') { current = state::raw_string; i += 2; continue; }
+                    if (c == '\"') { current = state::string; continue; }
+                    if (c == '{') { ++depth; continue; }
+                    if (c == '}') { depth -= depth != 0; continue; }
+                    if (c == ';' && depth == 0) {
+                        has_code  = false;
+                        from      = i + 1;
+                        directive = false;
+                        return i + 1;
+                    }
+                }
+                if (eof && current == state::directive) {
+                    current   = state::code;
+                    from      = text.size();
+                    directive = true;
+                    return text.size();
+                }
+                from = i;
+                return std::string_view::npos;
+            }
+        };
+    }
+    
+    struct cpp_subset_compiler {
+        std::pmr::string src;
+        std::string      msg;
+        std::pmr::string out;
+        compile_options  options;
+        std::size_t      macro_expansions = 0;
+        // String table of options.intern_strings in order of first appearance, deque keeps the keys of indices valid.
+        std::deque<std::string>                             interned_strings{};
+        std::unordered_map<std::string_view, std::uint32_t> interned_indices{};
+        std::size_t                                         interned_references = 0;
+        
+        static constexpr std::string_view keywords[255] = {
+            "int8_t",       "uint8_t",   "int16_t",        "uint16_t",
+            "int",          "uint32_t",  "int64_t",        "uint64_t",
+            "float",        "double",    "bool",           "std::string",    
+            // Containers.
+            "std::vector", "std::deque",  "std::list", "std::forward_list", "std::hive", "std::set", "std::multiset",
+            "std::unordered_set", "std::unordered_multiset", "std::map", "std::multimap", "std::unordered_map", "std::unordered_multimap",
+            "std::pair",           "std::array",             "std::tuple",
+            
+            // Structure.
+            "struct", "class"
+        };
+
+        static constexpr std::string_view operators[] = {
             ",", "{", "}", "<", ">", ";", "="
         };
         
@@ -860,6 +2298,7 @@ template <typename K, typename V, typename ... OtherStuff> \
                     std::string_view key(&src[i], k - &src[i]);
                     if (macro_map.contains(key)) {
                         out.append(macro_map.at(key));
+                        ++macro_expansions;
                     } else {
                         out.append(key);
                     }
@@ -885,6 +2324,8 @@ template <typename K, typename V, typename ... OtherStuff> \
                         }
                         out.append(std::string_view(src.data() + i + 1, j + 1 - i));
                         i = j + 1;
+                    } else {
+                        out.push_back(src[i]);
                     } break;
                 case '\"': {
                     // Doesn't support multiline string.
@@ -949,56 +2390,118 @@ template <typename K, typename V, typename ... OtherStuff> \
         }
 
         // This step must after remove comment and normalize string.
-        template <typename Iter>
-        constexpr void tokenize_source(Iter it) noexcept {
-            for (std::size_t i = 0; i < src.length(); ++i) {
-                if (std::isspace(src[i])) {
-                    auto p = std::find_if_not(&src[i], &src[src.length()], [](auto& c) {
-                        return std::isspace(static_cast<int>(c));
-                    });
-                    i = p - src.data() - 1;
+        // Lexes the token at or after src[i] and moves i past it, returns false at the end of source or on an invalid
+        // character (msg is set then).
+        constexpr bool next_token(std::size_t& i, std::string_view& token) noexcept {
+            while (i < src.length() && std::isspace(static_cast<unsigned char>(src[i]))) {
+                ++i;
+            }
+            if (i >= src.length()) {
+                return false;
+            }
+            if (std::isalpha(src[i]) || src[i] == '_' || src[i] == ':') {
+                auto p = std::find_if_not(&src[i], &src[src.length()], [](auto ch) {
+                    return std::isalnum(ch) || ch == '_' || ch == ':';
+                });
+                token = std::string_view(&src[i], p - &src[i]);
+                i = p - src.data();
+            }
+            else if (src[i] == '\"') {
+                // This step won't fail because we have successfully normalized all strings in normalize_string.
+                std::size_t j = src.find(")\"", i + 2);
+                token = std::string_view(&src[i], j - i + 2);
+                i = j + 2;
+            }
+            else if (auto op = std::string_view(&src[i], 1);
+                std::find(std::begin(operators), std::end(operators), op) != std::end(operators)) {
+                token = op;
+                ++i;
+            }
+            else if (std::isxdigit(src[i]) || src[i] == '.' || src[i] == '-' || src[i] == '+') {
+                auto p = std::find_if_not(&src[i], &src[src.length()], [](auto ch) {
+                    return std::isxdigit(ch) || ch == '.' || ch == '-' || ch == '+';
+                });
+                if (std::find(std::begin(isfx), std::end(isfx), std::string_view(p, 1)) != std::end(isfx)) {
+                    ++p;
                 }
-                else if (std::isalpha(src[i]) || src[i] == '_' || src[i] == ':') {
-                    auto p = std::find_if_not(&src[i], &src[src.length()], [](auto ch) {
-                        return std::isalnum(ch) || ch == '_' || ch == ':';
-                    });
-                    *it++ = std::string_view(&src[i], p - &src[i]);
-                    i = p - src.data() - 1;
-                }
-                else if (src[i] == '\"') {
-                    // This step won't fail because we have successfully normalized all strings in normalize_string.
-                    std::size_t j = src.find(")\"", i + 2);
-                    *it++ = std::string_view(&src[i], j - i + 2);
-                    i = j + 1;
-                }
-                else if (auto op = std::string_view(&src[i], 1);
-                    std::find(std::begin(operators), std::end(operators), op) != std::end(operators)) {
-                    *it++ = op;
-                }
-                else if (std::isxdigit(src[i]) || src[i] == '.' || src[i] == '-' || src[i] == '+') {
-                    auto p = std::find_if_not(&src[i], &src[src.length()], [](auto ch) {
-                        return std::isxdigit(ch) || ch == '.' || ch == '-' || ch == '+';
-                    });
-                    std::size_t j = i;
-                    i = p - src.data() - 1;
-                    if (std::find(std::begin(isfx), std::end(isfx), std::string_view(p, 1)) != std::end(isfx)) {
-                        ++p; ++i;
-                    }
-                    if (std::find(std::begin(isfx), std::end(isfx), std::string_view(p, 2)) != std::end(isfx)) {
-                        ++p; ++i;
+                if (std::find(std::begin(isfx), std::end(isfx), std::string_view(p, 2)) != std::end(isfx)) {
+                    ++p;
+                }
+                if (std::find(std::begin(isfx), std::end(isfx), std::string_view(p, 3)) != std::end(isfx)) {
+                    ++p;
+                }
+                token = std::string_view(&src[i], p - &src[i]);
+                i = p - src.data();
+            }
+            else {
+                msg = "Invalid character!";
+                return false;
+            }
+            return true;
+        } // next_token.
+
+        // Pulls tokens of src on demand one top level declaration at a time, so lexing interleaves with code generation
+        // and only the tokens of the current declaration are held instead of the whole source.
+        struct token_stream {
+            cpp_subset_compiler& compiler;
+            std::size_t          position = 0;
+            std::size_t          count    = 0;  // Tokens pulled so far.
+
+            bool                 in_value_list = false; // Inside the top-level braces of a container declaration.
+
+            // Refills tokens with the next declaration, up to its ';' outside of braces. False when none is left.
+            // A container declaration stops after the '{' of its value list instead, so that the caller pulls
+            // its elements one by one with next_element and a long list never sits in tokens as a whole.
+            bool next_declaration(std::pmr::vector<std::string_view>& tokens) {
+                tokens.clear();
+                std::size_t      depth = 0;
+                std::size_t      tid   = 0;
+                std::string_view token;
+                while (compiler.next_token(position, token)) {
+                    ++count;
+                    if (token == "{" && depth == 0 && tid > 12 && tid < 26 && !tokens.empty() && tokens.back() == "=") {
+                        tokens.push_back(token);
+                        in_value_list = true;
+                        return true;
                     }
-                    if (std::find(std::begin(isfx), std::end(isfx), std::string_view(p, 3)) != std::end(isfx)) {
-                        ++p; ++i;
+                    tokens.push_back(token);
+                    if      (token == "{") { ++depth; }
+                    else if (token == "}") { depth -= depth != 0; }
+                    else if (token == ";" && depth == 0) { return true; }
+                    else if (tid == 0 && depth == 0) {
+                        if (auto i = std::find(std::begin(keywords), std::end(keywords), token); i != std::end(keywords)) {
+                            tid = i - std::begin(keywords) + 1;
+                        }
                     }
-                    --p;
-                    *it++ = std::string_view(&src[j], p - &src[j] + 1);
                 }
-                else {
-                    msg = "Invalid character!";
-                    return;
+                return !tokens.empty() && compiler.msg.empty();
+            }
+
+            // Refills tokens with the next element of the open value list, without its ',' or closing '}'.
+            // The closing '}' ends the list. False when no element is left.
+            bool next_element(std::pmr::vector<std::string_view>& tokens) {
+                tokens.clear();
+                std::size_t      depth = 0;
+                std::string_view token;
+                while (in_value_list && compiler.next_token(position, token)) {
+                    ++count;
+                    if (depth == 0 && (token == "," || token == "}")) {
+                        in_value_list = token == ",";
+                        return !tokens.empty();
+                    }
+                    tokens.push_back(token);
+                    if      (token == "{") { ++depth; }
+                    else if (token == "}") { --depth; }
                 }
-            } // for loop.
-        } // tokenize_source.
+                return false;
+            }
+
+            // Consumes the next token, true when it is the expected one.
+            bool next_is(std::string_view expected) {
+                std::string_view token;
+                return compiler.next_token(position, token) && ++count && token == expected;
+            }
+        };
 
         template <details::std_basic_type Ty>
         static constexpr Ty compile_basic_value(std::string_view value) {
@@ -1033,7 +2536,7 @@ template <typename K, typename V, typename ... OtherStuff> \
             return Ty{};
         }
         
-        static constexpr void compile_basic_type_to_buffer(std::string_view type, std::string_view value, std::string& buf) {
+        static constexpr void compile_basic_type_to_buffer(std::string_view type, std::string_view value, std::pmr::string& buf) {
     #define DEFINE_COMPILE_FIXED_VALUE(t)                             \
         do {                                                          \
         if (type == #t) {                                             \
@@ -1071,12 +2574,66 @@ template <typename K, typename V, typename ... OtherStuff> \
             return std::prev(i);
         }
 
+        // Appends index of the string in the string table, adding it when it's new.
+        void intern_string(std::string_view str, std::pmr::string& buf) {
+            auto it = interned_indices.find(str);
+            if (it == interned_indices.end()) {
+                const auto index = static_cast<std::uint32_t>(interned_strings.size());
+                it = interned_indices.emplace(interned_strings.emplace_back(str), index).first;
+            }
+            buf.append(reinterpret_cast<const char*>(&it->second), sizeof(std::uint32_t));
+            ++interned_references;
+        }
+
+        // String table block, a std::vector<std::string> with a sub-index of stride 1.
+        std::pmr::string string_table_block() const {
+            constexpr std::size_t word = sizeof(std::size_t);
+            std::pmr::string block(out.get_allocator());
+            std::string      tag = std_type_name_string<std::vector<std::string>>(true);
+            tag.append(archive::string_table_name).push_back('\0');
+            const std::size_t n = interned_strings.size();
+            block.append(word, '\0');
+            block.append(tag);
+            const std::size_t value = block.size();
+            std::vector<std::size_t> entries;
+            entries.reserve(n + 2);
+            block.append(reinterpret_cast<const char*>(&n), word);
+            for (auto& i : interned_strings) {
+                entries.push_back(block.size() - value);
+                block.append(i).push_back('\0');
+            }
+            entries.push_back(n);
+            entries.push_back(1);
+            block.append(reinterpret_cast<const char*>(entries.data()), entries.size() * word);
+            const std::size_t offset = (block.size() - word) | offset_block_has_sub_index;
+            std::memcpy(block.data(), &offset, word);
+            if (options.checksums) {
+                details::seal_block(block, 0);
+            }
+            return block;
+        }
+
+        // Appends a field directory entry, see offset_block_has_field_directory.
+        static void append_field_entry(std::pmr::string& directory, std::size_t offset, std::string_view type, std::string_view path) {
+            directory.append(reinterpret_cast<const char*>(&offset), sizeof(std::size_t));
+            directory.append(type).append(path).push_back('\0');
+        }
+
+        // When element_offsets is not null, offsets of every options.sub_index_stride elements of a sequential container
+        // (relative to the begin of its elements) are recorded, nested containers never record.
+        // When field_directory is not null, fields of structures are recorded into it with their paths after path_prefix.
         template <class Iter>
-        constexpr auto compile_values_recursively(Iter ttb, Iter tte, Iter vtb, Iter vte, std::string& buf) {
+        constexpr auto compile_values_recursively(Iter ttb, Iter tte, Iter vtb, Iter vte, std::pmr::string& buf,
+                                                  std::vector<std::size_t>* element_offsets = nullptr,
+                                                  std::pmr::string* field_directory = nullptr, std::string_view path_prefix = {}) {
             // Means basic type -- recursive end scenario.
             const std::size_t tid = std::find(std::begin(keywords), std::end(keywords), *ttb) - std::begin(keywords) + 1;
             if (tid < 13) {
-                compile_basic_type_to_buffer(*ttb, *vtb, buf);
+                if (tid == 12 && options.intern_strings) {
+                    intern_string(vtb->substr(2, vtb->length() - 4), buf);
+                } else {
+                    compile_basic_type_to_buffer(*ttb, *vtb, buf);
+                }
                 return  std::make_pair(std::next(ttb), std::next(vtb)) ;
             }
             // Template types.
@@ -1085,20 +2642,25 @@ template <typename K, typename V, typename ... OtherStuff> \
                 tte = find_matching_bracket<'<', '>'>(std::next(ttb), tte);
                 vte = find_matching_bracket<'{', '}'>(vtb, vte);
                 ttb = std::next(ttb, 2);
-                std::string cache;
+                std::pmr::string cache(out.get_allocator());
                 std::size_t n = 0;
+                // Empty braces have no element to compile.
+                const Iter first = std::next(vtb) == vte ? vte : vtb;
                 // Branch recursion.
                 switch(tid) {
                 default: break;
                 // Sequential containers (not map nor pair && tuple && array)
                 case 13: case 14: case 15: case 16: case 17: case 18: case 19: case 20: case 21:
-                    for (auto k = vtb; k != vte; ++n) {
+                    for (auto k = first; k != vte; ++n) {
+                        if (element_offsets != nullptr && n % options.sub_index_stride == 0) {
+                            element_offsets->push_back(cache.size());
+                        }
                         k = compile_values_recursively(ttb, tte, std::next(k), vte, cache).second;
                     }
                     buf.append(reinterpret_cast<const char*>(&n), sizeof(n)); break;
                 // Mapping containers 
                 case 22: case 23: case 24: case 25:
-                    for (auto k = vtb; k != vte; ++n) {
+                    for (auto k = first; k != vte; ++n) {
                         auto p1 = compile_values_recursively(ttb, tte, std::next(k, 2), vte, cache);
                         auto p2 = compile_values_recursively(std::next(p1.first), tte, std::next(p1.second), vte, cache);
                         k = std::next(p2.second);
@@ -1132,11 +2694,21 @@ template <typename K, typename V, typename ... OtherStuff> \
                     if (*k != "struct" && *k != "class") {
                         auto assign = std::find(k, vte, "=");
                         auto semico = std::find(assign, vte, ";");
+                        if (field_directory != nullptr) {
+                            append_field_entry(*field_directory, buf.size(), compile_type_name(k, std::prev(assign)),
+                                               std::string(path_prefix).append(*std::prev(assign)));
+                        }
                         compile_values_recursively(k, std::prev(assign), std::next(assign), semico, buf);
                         k = semico;
                     } else {
                         auto h = find_matching_bracket<'{','}'>(std::next(k, 2), vte);
-                        compile_values_recursively(k, std::next(k, 2), std::next(k, 2),h, buf);
+                        std::string path;
+                        if (field_directory != nullptr) {
+                            path.assign(path_prefix).append(*std::next(h));
+                            append_field_entry(*field_directory, buf.size(), std::string(1, '\xFF').append(*std::next(k)).append(1, '\0'), path);
+                            path.push_back('.');
+                        }
+                        compile_values_recursively(k, std::next(k, 2), std::next(k, 2),h, buf, nullptr, field_directory, path);
                         k = std::next(h, 2);
                     }
                 }
@@ -1170,53 +2742,129 @@ template <typename K, typename V, typename ... OtherStuff> \
             return buf;
         }
         
-        template <class Container>
-        constexpr void generate_byte_code(const Container& tokens) {
+        void generate_byte_code(token_stream& stream) {
             out.clear();
-            out.reserve(tokens.size());
-            for (auto t = tokens.begin(); t != tokens.end(); ++t) {
-                if (auto i = std::find(std::begin(keywords), std::end(keywords), *t); i != std::end(keywords)) {
-                    std::string              value_cache;
-                    std::string              variable_name_cache;
-                    std::string              type_cache;
-                    decltype(tokens.end())   semicolumn;
+            out.reserve(src.size());
+            // Reused by every declaration, so it only grows to the largest one.
+            std::pmr::vector<std::string_view> tokens(out.get_allocator().resource());
+            std::pmr::vector<std::string_view> element(out.get_allocator().resource());
+            while (stream.next_declaration(tokens)) {
+                for (auto t = tokens.begin(); t != tokens.end(); ++t) {
+                    if (auto i = std::find(std::begin(keywords), std::end(keywords), *t); i != std::end(keywords)) {
+                        std::pmr::string         value_cache(out.get_allocator());
+                        std::string              variable_name_cache;
+                        std::string              type_cache;
+                        std::vector<std::size_t> sub_index;
+                        std::pmr::string         field_directory(out.get_allocator());
+                        std::size_t              block_flags = 0;
+                        const std::size_t        references  = interned_references;
+                        decltype(tokens.end())   semicolumn;
                     
-                    if (*t == "struct" || *t == "class") {
-                        type_cache.push_back('\xFF');
-                        type_cache.append(*std::next(t));
-                        type_cache.push_back('\0');
-                        auto struct_end = find_matching_bracket<'{', '}'>(std::next(t, 2), tokens.end());
-                        variable_name_cache = *std::next(struct_end);
-                        variable_name_cache.push_back('\0');
-                        semicolumn = std::next(struct_end, 2); 
-                        compile_values_recursively(t, std::next(t, 2), std::next(t, 2), struct_end, value_cache);
-                    }
-                    else {
-                        auto assign = std::find(t, tokens.end(), "=");
-                        if (assign == tokens.end()) {
-                            msg = "Missing assign operator (=).";
-                            return;
+                        if (*t == "struct" || *t == "class") {
+                            type_cache.push_back('\xFF');
+                            type_cache.append(*std::next(t));
+                            type_cache.push_back('\0');
+                            auto struct_end = find_matching_bracket<'{', '}'>(std::next(t, 2), tokens.end());
+                            variable_name_cache = *std::next(struct_end);
+                            variable_name_cache.push_back('\0');
+                            semicolumn = std::next(struct_end, 2); 
+                            compile_values_recursively(t, std::next(t, 2), std::next(t, 2), struct_end, value_cache, nullptr,
+                                                       options.field_directory ? &field_directory : nullptr);
                         }
-                        semicolumn = std::find(assign, tokens.end(), ";");
-                        if (semicolumn == tokens.end()) {
-                            msg = "Missing ; after expression.";
-                            return;
+                        else {
+                            auto assign = std::find(t, tokens.end(), "=");
+                            if (assign == tokens.end()) {
+                                msg = "Missing assign operator (=).";
+                                return;
+                            }
+                            const std::size_t tid = i - std::begin(keywords) + 1;
+                            // Only sequential containers (vector, deque, list and forward_list) get a sub-index.
+                            const bool indexed = options.sub_index_stride != 0 && tid > 12 && tid < 17;
+                            type_cache = compile_type_name(t, std::prev(assign));
+                            variable_name_cache = *std::prev(assign);
+                            variable_name_cache.push_back('\0');
+                            if (stream.in_value_list) {
+                                // Same layout as compile_values_recursively, but the elements are pulled and
+                                // compiled one at a time, the count goes in once they are all known.
+                                auto tte = find_matching_bracket<'<', '>'>(std::next(t), std::prev(assign));
+                                auto ttb = std::next(t, 2);
+                                std::size_t n = 0;
+                                value_cache.append(sizeof(std::size_t), '\0');
+                                for (; stream.next_element(element); ++n) {
+                                    if (indexed && n % options.sub_index_stride == 0) {
+                                        sub_index.push_back(value_cache.size() - sizeof(std::size_t));
+                                    }
+                                    if (tid < 22) {
+                                        compile_values_recursively(ttb, tte, element.begin(), element.end(), value_cache);
+                                    } else {
+                                        auto p1 = compile_values_recursively(ttb, tte, std::next(element.begin()), element.end(), value_cache);
+                                        compile_values_recursively(std::next(p1.first), tte, std::next(p1.second), element.end(), value_cache);
+                                    }
+                                }
+                                if (!msg.empty()) {
+                                    return;
+                                }
+                                if (stream.in_value_list || !stream.next_is(";")) {
+                                    msg = "Missing ; after expression.";
+                                    return;
+                                }
+                                value_cache.replace(0, sizeof(std::size_t), reinterpret_cast<const char*>(&n), sizeof(std::size_t));
+                                semicolumn = std::prev(tokens.end());
+                            } else {
+                                semicolumn = std::find(assign, tokens.end(), ";");
+                                if (semicolumn == tokens.end()) {
+                                    msg = "Missing ; after expression.";
+                                    return;
+                                }
+                                compile_values_recursively(t, std::prev(assign), std::next(assign), semicolumn, value_cache,
+                                                           indexed ? &sub_index : nullptr);
+                            }
+                            t = semicolumn;
                         }
-                        type_cache = compile_type_name(t, std::prev(assign));
-                        variable_name_cache = *std::prev(assign);
-                        variable_name_cache.push_back('\0');
-                        compile_values_recursively(t, std::prev(assign), std::next(assign), semicolumn, value_cache);
+
+                        // A container no longer than one stride gains nothing from the sub-index.
+                        if (sub_index.size() > 1) {
+                            for (auto o : sub_index) {
+                                o += sizeof(std::size_t); // Skip element count.
+                                value_cache.append(reinterpret_cast<const char*>(&o), sizeof(std::size_t));
+                            }
+                            const std::size_t count = sub_index.size();
+                            value_cache.append(reinterpret_cast<const char*>(&count), sizeof(std::size_t));
+                            value_cache.append(reinterpret_cast<const char*>(&options.sub_index_stride), sizeof(std::size_t));
+                            block_flags |= offset_block_has_sub_index;
+                        }
+                        if (interned_references != references) {
+                            block_flags |= offset_block_interned_strings;
+                        }
+                        if (!field_directory.empty()) {
+                            const std::size_t directory_size = field_directory.size();
+                            value_cache.append(field_directory);
+                            value_cache.append(reinterpret_cast<const char*>(&directory_size), sizeof(std::size_t));
+                            block_flags |= offset_block_has_field_directory;
+                        }
+                    
                         t = semicolumn;
+                        const std::size_t head   = out.size();
+                        const std::size_t offset = (type_cache.size() + variable_name_cache.size() + value_cache.size()) | block_flags;
+                        out.append(reinterpret_cast<const char*>(&offset), sizeof(std::size_t));
+                        out.append(type_cache);
+                        out.append(variable_name_cache);
+                        out.append(value_cache);
+                        if (options.checksums) {
+                            details::seal_block(out, head);
+                        }
+                        if (options.statistics != nullptr) {
+                            options.statistics->declaration_sizes.emplace_back(
+                                std::string_view(variable_name_cache).substr(0, variable_name_cache.size() - 1),
+                                out.size() - head);
+                        }
                     }
-                    
-                    t = semicolumn;
-                    const std::size_t offset = type_cache.size() + variable_name_cache.size() + value_cache.size();
-                    out.append(reinterpret_cast<const char*>(&offset), sizeof(std::size_t));
-                    out.append(type_cache);
-                    out.append(variable_name_cache);
-                    out.append(value_cache);
-                }
-            } // for loop
+                } // for loop
+            } // while loop
+            // Table goes first so that forward readers have it before any reference.
+            if (!interned_strings.empty()) {
+                out.insert(0, string_table_block());
+            }
             constexpr std::size_t end_mark = 0;
             out.append(reinterpret_cast<const char*>(&end_mark), sizeof(std::size_t));
         } // Generate byte code.
@@ -1227,8 +2875,7 @@ template <typename K, typename V, typename ... OtherStuff> \
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     
     template <class Ty>
-    constexpr std::string::const_iterator archive::find_variable_begin(std::string_view var_name) {
-        // Search tag.
+    constexpr std::string archive::variable_tag(std::string_view var_name) {
         std::string type_and_name;
         if constexpr (std_type<Ty>) {
             type_and_name = std_type_name_string<Ty>(true);
@@ -1236,45 +2883,2107 @@ template <typename K, typename V, typename ... OtherStuff> \
             type_and_name = structure_type_name_string<Ty>();
         }
         type_and_name.append(var_name).push_back('\0');
-        // Skip-field variable checking & searching method.
-        auto offset_block = content_.cbegin();
-        for (std::size_t
+        return type_and_name;
+    }
+
+    template <class Visit>
+    const char* archive::visit_journal_indices(Visit&& visit) const {
+        constexpr std::size_t word   = sizeof(std::size_t);
+        const char* const     base   = content_.data();
+        std::size_t           footer = content_.size(); // End of the segment, its magic included.
+        std::size_t           expect = 0;               // index_begin the later segment chained to.
+        for (;;) {
+            if (footer < word * 4 + journal_magic.size() ||
+                std::string_view(base + footer - journal_magic.size(), journal_magic.size()) != journal_magic) {
+                return "Missing journal footer.";
+            }
+            const std::size_t trailer = footer - journal_magic.size() - word * 2; // [previous][index_begin]
+            std::size_t index_begin = 0, previous = 0, count = 0;
+            std::memcpy(&previous,    base + trailer,        word);
+            std::memcpy(&index_begin, base + trailer + word, word);
+            if (index_begin > trailer - word || (expect != 0 && index_begin != expect)) {
+                return "Journal index exceeds content.";
+            }
+            std::memcpy(&count, base + index_begin, word);
+            if (count != (trailer - index_begin - word) / word || (trailer - index_begin) % word != 0) {
+                return "Journal index size mismatch.";
+            }
+            std::size_t segment_begin = 0;
+            if (previous != 0) {
+                // The previous footer ends where blocks of this segment start.
+                std::size_t previous_count = 0;
+                if (previous >= index_begin || index_begin - previous < word) {
+                    return "Journal index exceeds content.";
+                }
+                std::memcpy(&previous_count, base + previous, word);
+                if (previous_count > (index_begin - previous) / word ||
+                    (index_begin - previous) - previous_count * word < word * 3 + journal_magic.size()) {
+                    return "Journal index size mismatch.";
+                }
+                segment_begin = previous + word * (previous_count + 3) + journal_magic.size();
+            }
+            if (visit(index_begin, count, segment_begin) || previous == 0) {
+                return nullptr;
+            }
+            footer = segment_begin;
+            expect = previous;
+        }
+    }
+
+    constexpr std::string::const_iterator archive::find_offset_block(std::string_view tag) const {
+        if (is_journaled()) {
+            const char* base  = content_.data();
+            std::size_t found = 0;
+            const char* msg   = visit_journal_indices([&](std::size_t index_begin, std::size_t count, std::size_t) {
+                for (std::size_t i = count; i-- != 0;) {
+                    const std::size_t block = *reinterpret_cast<const std::size_t*>(base + index_begin + sizeof(std::size_t) * (i + 1));
+                    const std::size_t size  = *reinterpret_cast<const std::size_t*>(base + block) & ~offset_block_flag_mask;
+                    if (tag.size() <= size && std::equal(tag.cbegin(), tag.cend(), content_.cbegin() + block + sizeof(std::size_t))) {
+                        found = block;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (msg != nullptr) {
+                return content_.cend();
+            }
+            if (found != 0) {
+                return content_.cbegin() + found;
+            }
+            // Not appended since, so it's in the plain content at the front (ended by its end mark).
+        }
+        // Skip-field variable checking & searching method.
+        auto offset_block = content_.cbegin();
+        for (std::size_t
             offset = *reinterpret_cast<const std::size_t*>(&*offset_block);
             offset != 0;
             offset = *reinterpret_cast<const std::size_t*>(&*offset_block)) {
             // A very weird technique I developed. 
-            offset_block += sizeof(std::size_t);
-            if (std::equal(type_and_name.cbegin(), type_and_name.cend(), offset_block)) {
-                return offset_block + type_and_name.size();
+            if ((offset & offset_block_erased) == 0 && tag.size() <= (offset & ~offset_block_flag_mask) &&
+                std::equal(tag.cbegin(), tag.cend(), offset_block + sizeof(std::size_t))) {
+                return offset_block;
+            }
+            offset_block += sizeof(std::size_t) + (offset & ~offset_block_flag_mask);
+        }
+        return content_.cend();
+    }
+
+    namespace details {
+
+        // Checks one offset block starting at its offset word p, on success p is moved to the next block
+        // and nullptr is returned, otherwise the reason. Values with interned strings are checked against strings,
+        // when it's null only their block is checked and 'interned' is set so that they are checked again later.
+        inline const char* validate_offset_block(const char*& p, const char* const end,
+                                                 const string_table_view* strings = nullptr, bool* interned = nullptr) noexcept {
+            constexpr std::size_t word = sizeof(std::size_t);
+            const char* const block = p;
+            std::size_t offset = 0;
+            std::memcpy(&offset, p, word);
+            p += word;
+            const std::size_t size = offset & ~offset_block_flag_mask;
+            if (size > static_cast<std::size_t>(end - p)) {
+                return "Offset block exceeds content.";
+            }
+            const char* const block_end = p + size;
+            const char*       value_end = block_end;
+            if (offset & offset_block_erased) {
+                p = block_end;
+                return nullptr;
+            }
+
+            binary_type_node type;
+            if (!parse_binary_type_signature(p, block_end, type)) {
+                return "Invalid type signature.";
+            }
+            const char* name_end = static_cast<const char*>(std::memchr(p, '\0', block_end - p));
+            if (name_end == nullptr) {
+                return "Unterminated variable name.";
+            }
+            const char* const value = name_end + 1;
+
+            // Sub-index must point to element boundaries of a top level sequential container.
+            std::size_t index_count = 0, index_stride = 0;
+            const char* index = nullptr;
+            if (offset & offset_block_has_sub_index) {
+                if (type.identifier < 13 || type.identifier > 16 || static_cast<std::size_t>(block_end - value) < word * 2) {
+                    return "Invalid sub-index.";
+                }
+                std::memcpy(&index_stride, block_end - word, word);
+                std::memcpy(&index_count,  block_end - word * 2, word);
+                if (index_stride == 0 || index_count > (static_cast<std::size_t>(block_end - value) - word * 2) / word) {
+                    return "Invalid sub-index.";
+                }
+                index     = block_end - word * (index_count + 2);
+                value_end = index;
+            }
+            if (offset & offset_block_has_checksum) {
+                if (!verify_block_checksum(block + word, block_end, offset)) {
+                    return "Checksum mismatch.";
+                }
+                value_end = block_checksum(block + word, block_end, offset);
+                if (value_end < value) {
+                    return "Invalid checksum.";
+                }
+            }
+            p = block_end;
+            if ((offset & offset_block_interned_strings) && strings == nullptr) {
+                if (interned == nullptr) {
+                    return "Missing string table.";
+                }
+                *interned = true;
+                return nullptr;
+            }
+            if ((offset & offset_block_interned_strings) == 0) {
+                strings = nullptr;
+            }
+
+            // Fields listed by the directory must follow each other from the start of the value to its end, each one
+            // matching its recorded type. A nested structure starts where its first field does.
+            if (offset & offset_block_has_field_directory) {
+                std::size_t directory_size = 0;
+                if (type.identifier != 0xFF || static_cast<std::size_t>(block_end - value) < word ||
+                    (std::memcpy(&directory_size, block_end - word, word), directory_size > static_cast<std::size_t>(block_end - value) - word)) {
+                    return "Invalid field directory.";
+                }
+                const char* const fields_end = std::min(value_end, block_end - word - directory_size);
+                const char*       field_end  = value;
+                const bool sound = visit_field_directory(name_end, block_end, [&](std::size_t field, const binary_type_node& field_type, std::string_view) {
+                    if (field_end == nullptr || field != static_cast<std::size_t>(field_end - value)) {
+                        field_end = nullptr;
+                    } else if (field_type.identifier != 0xFF) {
+                        field_end = walk_binary_value(field_type, field_end, fields_end, strings);
+                    }
+                });
+                if (!sound) {
+                    return "Invalid field directory.";
+                }
+                return field_end != fields_end ? "Value doesn't match its field directory." : nullptr;
+            }
+
+            // Without a directory nothing bounds the fields, reads of such a structure can't be made safe.
+            if (type.identifier == 0xFF) {
+                return "Structure without field directory can't be checked.";
+            }
+            if (index == nullptr) {
+                return walk_binary_value(type, value, value_end, strings) != value_end ? "Value doesn't match its type signature." : nullptr;
+            }
+            // Walk elements one by one to check every recorded offset.
+            std::size_t n = 0;
+            if (static_cast<std::size_t>(value_end - value) < word) {
+                return "Value doesn't match its type signature.";
+            }
+            std::memcpy(&n, value, word);
+            if (index_count != (n + index_stride - 1) / index_stride) {
+                return "Invalid sub-index.";
+            }
+            const char* e = value + word;
+            for (std::size_t i = 0; i != n && e != nullptr; ++i) {
+                if (i % index_stride == 0) {
+                    std::size_t entry = 0;
+                    std::memcpy(&entry, index + i / index_stride * word, word);
+                    if (entry != static_cast<std::size_t>(e - value)) {
+                        return "Invalid sub-index.";
+                    }
+                }
+                e = walk_binary_value(type.arguments[0], e, value_end, strings);
+            }
+            return e != value_end ? "Value doesn't match its type signature." : nullptr;
+        }
+    }
+
+    inline std::string archive::verify_checksums() const noexcept {
+        constexpr std::size_t word  = sizeof(std::size_t);
+        const char* const     base  = content_.data();
+        auto verify = [&](std::size_t block, std::size_t limit, std::size_t& size) -> const char* {
+            std::size_t offset = 0;
+            if (block > limit || limit - block < word) {
+                return "Offset block exceeds content.";
+            }
+            std::memcpy(&offset, base + block, word);
+            size = offset & ~offset_block_flag_mask;
+            if (size > limit - block - word) {
+                return "Offset block exceeds content.";
+            }
+            if ((offset & offset_block_has_checksum) && (offset & offset_block_erased) == 0 &&
+                !details::verify_block_checksum(base + block + word, base + block + word + size, offset)) {
+                return "Checksum mismatch.";
+            }
+            return nullptr;
+        };
+        std::size_t size  = 0;
+        std::size_t limit = content_.size(); // Plain content ends before the oldest journal index.
+        if (is_journaled()) {
+            const char* failed = nullptr;
+            if (const char* msg = visit_journal_indices([&](std::size_t index_begin, std::size_t count, std::size_t) {
+                    for (std::size_t i = 0; i != count && failed == nullptr; ++i) {
+                        std::size_t block = 0;
+                        std::memcpy(&block, base + index_begin + word * (i + 1), word);
+                        failed = verify(block, index_begin, size);
+                    }
+                    limit = index_begin;
+                    return failed != nullptr;
+                })) {
+                return msg;
+            }
+            if (failed != nullptr) {
+                return failed;
+            }
+        }
+        for (std::size_t p = 0;; p += word + size) {
+            if (limit - p < word) {
+                return "Missing end mark of offset blocks.";
+            }
+            std::size_t offset = 0;
+            if (std::memcpy(&offset, base + p, word), offset == 0) {
+                return {};
+            }
+            if (const char* msg = verify(p, limit, size)) {
+                return msg;
+            }
+        }
+    }
+
+    inline void archive::add_checksums() {
+        constexpr std::size_t word = sizeof(std::size_t);
+        if (is_journaled()) {
+            compact();
+        }
+        std::string sealed;
+        sealed.reserve(content_.size());
+        for (auto block : alive_offset_blocks()) {
+            std::size_t offset = 0;
+            std::memcpy(&offset, content_.data() + block, word);
+            const std::size_t head = sealed.size();
+            sealed.append(content_, block, word + (offset & ~offset_block_flag_mask));
+            if ((offset & offset_block_has_checksum) == 0) {
+                details::seal_block(sealed, head);
+            }
+        }
+        sealed.append(word, '\0');
+        content_ = std::move(sealed);
+    }
+
+    inline std::string archive::validate() const noexcept {
+        const char*       p    = content_.data();
+        const char* const end  = content_.data() + content_.size();
+        constexpr std::size_t word = sizeof(std::size_t);
+        // Blocks with interned strings are checked once all blocks (string table included) are known to be sound.
+        std::vector<std::pair<const char*, const char*>> interned_blocks;
+        auto check = [&](const char*& b, const char* block_end) {
+            const char* begin    = b;
+            bool        interned = false;
+            const char* msg      = details::validate_offset_block(b, block_end, nullptr, &interned);
+            if (interned) {
+                interned_blocks.emplace_back(begin, block_end);
+            }
+            return msg;
+        };
+        auto check_interned = [&]() -> std::string {
+            if (interned_blocks.empty()) {
+                return {};
+            }
+            const details::string_table_view table = string_table();
+            std::size_t stride = 0;
+            if (table.value == nullptr || (std::memcpy(&stride, table.entries + (table.count + 1) * word, word), stride != 1)) {
+                return "Missing string table.";
+            }
+            for (auto [b, block_end] : interned_blocks) {
+                if (const char* msg = details::validate_offset_block(b, block_end, &table)) {
+                    return msg;
+                }
+            }
+            return {};
+        };
+        // Blocks of each journal segment lie between the index before and its own index, those of the oldest segment
+        // follow the end mark of the plain content, which ends before the oldest index.
+        const char* plain_end    = end;
+        std::size_t oldest_first = content_.size();
+        if (is_journaled()) {
+            const char* failed = nullptr;
+            if (const char* msg = visit_journal_indices([&](std::size_t index_begin, std::size_t count, std::size_t segment_begin) {
+                    oldest_first = index_begin;
+                    for (std::size_t i = 0; i != count && failed == nullptr; ++i) {
+                        std::size_t block = 0;
+                        std::memcpy(&block, p + index_begin + word * (i + 1), word);
+                        if (block < segment_begin || block > index_begin || index_begin - block < word) {
+                            failed = "Journal entry exceeds content.";
+                            break;
+                        }
+                        oldest_first = std::min(oldest_first, block);
+                        const char* b = p + block;
+                        failed = check(b, p + index_begin);
+                    }
+                    plain_end = p + index_begin;
+                    return failed != nullptr;
+                })) {
+                return msg;
+            }
+            if (failed != nullptr) {
+                return failed;
+            }
+        }
+        for (;;) {
+            if (static_cast<std::size_t>(plain_end - p) < word) {
+                return "Missing end mark of offset blocks.";
+            }
+            std::size_t offset = 0;
+            std::memcpy(&offset, p, word);
+            if (offset == 0) {
+                if (is_journaled() && static_cast<std::size_t>(p + word - content_.data()) > oldest_first) {
+                    return "Journal entry exceeds content.";
+                }
+                return check_interned();
+            }
+            if (const char* msg = check(p, plain_end)) {
+                return msg;
+            }
+        }
+    }
+
+    template <std::invocable<std::string_view> Sink>
+    std::string archive::decompile(Sink&& sink, flag_t flag) const {
+        constexpr std::size_t word = sizeof(std::size_t);
+        const char* const     base = content_.data();
+        const std::vector<std::size_t> blocks = content_.empty() ? std::vector<std::size_t>{} : alive_offset_blocks();
+
+        // Headers first, signatures are parsed again below which is cheap compared to values.
+        details::binary_value_decompiler<std::remove_reference_t<Sink>> d{sink, std_basic_type_text_output_formatter{flag}};
+        const details::string_table_view table = string_table();
+        bool headers[std::size(details::binary_type_headers)]{};
+        for (auto block : blocks) {
+            const char* p = base + block + word;
+            details::binary_type_node type;
+            if (details::parse_binary_type_signature(p, base + content_.size(), type)) {
+                details::binary_type_identifiers(type, headers);
+            }
+            std::size_t offset = 0;
+            std::memcpy(&offset, base + block, word);
+            const char* name_end = static_cast<const char*>(std::memchr(p, '\0', base + content_.size() - p));
+            if (type.identifier == 0xFF && (offset & offset_block_has_field_directory) && name_end != nullptr &&
+                (offset & ~offset_block_flag_mask) <= content_.size() - block - word) {
+                details::visit_field_directory(name_end, base + block + word + (offset & ~offset_block_flag_mask),
+                                               [&](std::size_t, const details::binary_type_node& field, std::string_view) {
+                    details::binary_type_identifiers(field, headers);
+                });
+            }
+        }
+        d.buf.append("#pragma once\n");
+        for (std::size_t i = 0; i != std::size(headers); ++i) {
+            const std::string_view h = details::binary_type_headers[i];
+            if (headers[i] && !h.empty() && std::find(details::binary_type_headers, details::binary_type_headers + i, h) ==
+                                            details::binary_type_headers + i) {
+                d.buf.append("#include <").append(h).append(">\n");
+            }
+        }
+
+        for (auto block : blocks) {
+            std::size_t offset = 0;
+            if (content_.size() - block < word) {
+                return "Offset block exceeds content.";
+            }
+            std::memcpy(&offset, base + block, word);
+            const std::size_t size = offset & ~offset_block_flag_mask;
+            if (size > content_.size() - block - word) {
+                return "Offset block exceeds content.";
+            }
+            const char*       p         = base + block + word;
+            const char* const block_end = p + size;
+            const char*       value_end = block_end;
+
+            details::binary_type_node type;
+            if (!details::parse_binary_type_signature(p, block_end, type)) {
+                return "Invalid type signature.";
+            }
+            const char* name_end = static_cast<const char*>(std::memchr(p, '\0', block_end - p));
+            if (name_end == nullptr) {
+                return "Unterminated variable name.";
+            }
+            const std::string_view name(p, name_end - p);
+            // Strings are written in place, compiling with intern_strings builds the table again.
+            if (name == string_table_name) {
+                continue;
+            }
+            d.strings = (offset & offset_block_interned_strings) ? &table : nullptr;
+            if (d.strings != nullptr && table.value == nullptr) {
+                return "Missing string table.";
+            }
+            if (type.identifier == 0xFF && (offset & offset_block_has_field_directory) == 0) {
+                d.buf.append("\n// Structure ").append(type.name).append(" ").append(name)
+                     .append(" is skipped, compile it with compile_options::field_directory to record its fields.\n");
+                continue;
+            }
+            if (type.identifier == 0xFF) {
+                // Fields come from the directory, each one is decoded where its entry points.
+                const char* const value          = name_end + 1;
+                std::size_t       directory_size = 0;
+                if (static_cast<std::size_t>(block_end - value) < word ||
+                    (std::memcpy(&directory_size, block_end - word, word), directory_size > static_cast<std::size_t>(block_end - value) - word)) {
+                    return "Invalid field directory.";
+                }
+                value_end = block_end - word - directory_size;
+                if (offset & offset_block_has_checksum) {
+                    value_end = details::block_checksum(base + block + word, block_end, offset);
+                    if (value_end == nullptr || value_end < value) {
+                        return "Invalid checksum.";
+                    }
+                }
+                std::vector<std::string_view> open; // Paths of nested structures not closed yet.
+                auto close = [&] {
+                    const std::string_view path = open.back();
+                    open.pop_back();
+                    d.buf.append(open.size() * 4 + 4, ' ').append("}").append(path.substr(path.rfind('.') + 1)).append(";\n");
+                };
+                const char* failed = nullptr;
+                d.buf.append("\nstatic inline const\nstruct ").append(type.name).append("{\n");
+                const bool sound = details::visit_field_directory(name_end, block_end,
+                                                                  [&](std::size_t field, const details::binary_type_node& field_type, std::string_view path) {
+                    while (!open.empty() && !(path.starts_with(open.back()) && path.size() > open.back().size() && path[open.back().size()] == '.')) {
+                        close();
+                    }
+                    d.buf.append(open.size() * 4 + 4, ' ');
+                    if (field_type.identifier == 0xFF) {
+                        d.buf.append("struct ").append(field_type.name).append("{\n");
+                        open.push_back(path);
+                        return;
+                    }
+                    details::binary_type_text(field_type, d.buf);
+                    d.buf.append(" ").append(path.substr(path.rfind('.') + 1)).append(" = ");
+                    if (failed == nullptr && (field > static_cast<std::size_t>(value_end - value) ||
+                                              d.value(field_type, value + field, value_end) == nullptr)) {
+                        failed = "Value doesn't match its type signature.";
+                    }
+                    d.buf.append(";\n");
+                });
+                if (!sound) {
+                    return "Invalid field directory.";
+                }
+                if (failed != nullptr) {
+                    return failed;
+                }
+                while (!open.empty()) {
+                    close();
+                }
+                d.buf.append("}").append(name).append(";\n");
+                if (d.buf.size() >= d.flush_size) {
+                    d.flush();
+                }
+                continue;
+            }
+            if (offset & offset_block_has_sub_index) {
+                std::size_t count = 0;
+                if (static_cast<std::size_t>(block_end - name_end) < word * 2 + 1 ||
+                    (std::memcpy(&count, block_end - word * 2, word), count > static_cast<std::size_t>(block_end - name_end - 1) / word - 2)) {
+                    return "Invalid sub-index.";
+                }
+                value_end = block_end - word * (count + 2);
+            }
+            if (offset & offset_block_has_checksum) {
+                value_end = details::block_checksum(base + block + word, block_end, offset);
+                if (value_end == nullptr || value_end <= name_end) {
+                    return "Invalid checksum.";
+                }
+            }
+            d.buf.append("\nstatic inline const\n");
+            details::binary_type_text(type, d.buf);
+            d.buf.append(" ").append(name).append(" = ");
+            if (d.value(type, name_end + 1, value_end) != value_end) {
+                return "Value doesn't match its type signature.";
+            }
+            d.buf.append(";\n");
+            if (d.buf.size() >= d.flush_size) {
+                d.flush();
+            }
+        }
+        d.flush();
+        return {};
+    }
+
+    template <class Ty>
+    constexpr std::string::const_iterator archive::find_variable_begin(std::string_view var_name) {
+        const std::string type_and_name = variable_tag<Ty>(var_name);
+        if (auto it = find_offset_block(type_and_name); it != content_.cend()) {
+            return it + sizeof(std::size_t) + type_and_name.size();
+        }
+        return content_.cend();
+    }
+    
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///                                      Portable format
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    namespace details {
+
+        // Byte order and width of size words of compiled content.
+        struct binary_layout {
+            bool         big_endian = std::endian::native == std::endian::big;
+            std::uint8_t word       = sizeof(std::size_t);
+
+            friend constexpr bool operator==(const binary_layout&, const binary_layout&) = default;
+        };
+
+        inline constexpr binary_layout host_layout{};
+        inline constexpr binary_layout portable_layout{false, 8};
+
+        template <std::size_t Size>
+        inline void byteswap_scalar(char* dst, const char* src) noexcept {
+            for (std::size_t i = 0; i != Size; ++i) {
+                dst[i] = src[Size - 1 - i];
+            }
+        }
+
+        // Reverses bytes of each of count elements of Size bytes, dst and src may be the same.
+        template <std::size_t Size>
+        inline void byteswap_elements(char* dst, const char* src, std::size_t count) noexcept {
+            std::size_t i = 0;
+#if defined(__AVX2__) || defined(__SSSE3__)
+            // Shuffle mask reversing each Size bytes lane.
+            alignas(32) std::uint8_t mask[32];
+            for (std::size_t j = 0; j != 32; ++j) {
+                mask[j] = static_cast<std::uint8_t>((j % 16) / Size * Size + Size - 1 - j % Size);
+            }
+#if defined(__AVX2__)
+            const __m256i wide = _mm256_load_si256(reinterpret_cast<const __m256i*>(mask));
+            for (; (i + 32 / Size) <= count; i += 32 / Size) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * Size));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * Size), _mm256_shuffle_epi8(v, wide));
+            }
+#endif
+            const __m128i narrow = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+            for (; (i + 16 / Size) <= count; i += 16 / Size) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * Size));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * Size), _mm_shuffle_epi8(v, narrow));
+            }
+#elif defined(__ARM_NEON)
+            for (; (i + 16 / Size) <= count; i += 16 / Size) {
+                const uint8x16_t v = vld1q_u8(reinterpret_cast<const std::uint8_t*>(src + i * Size));
+                uint8x16_t       r;
+                if constexpr (Size == 2)      { r = vrev16q_u8(v); }
+                else if constexpr (Size == 4) { r = vrev32q_u8(v); }
+                else                          { r = vrev64q_u8(v); }
+                vst1q_u8(reinterpret_cast<std::uint8_t*>(dst + i * Size), r);
+            }
+#endif
+            for (; i != count; ++i) {
+                char tmp[Size];
+                byteswap_scalar<Size>(tmp, src + i * Size);
+                std::memcpy(dst + i * Size, tmp, Size);
+            }
+        }
+
+        // Rewrites compiled content of one layout to another, block by block following their type signatures.
+        struct layout_converter {
+            binary_layout from;
+            binary_layout to;
+            const char*   p;
+            const char*   end;
+            std::string&  out;
+            bool          interned = false;
+            const char*   error    = nullptr;
+
+            bool fail(const char* reason) {
+                error = reason;
+                return false;
+            }
+
+            bool read_word(std::uint64_t& v) {
+                if (static_cast<std::size_t>(end - p) < from.word) {
+                    return fail("Content is truncated.");
+                }
+                char bytes[8];
+                if (from.big_endian != (std::endian::native == std::endian::big)) {
+                    for (std::size_t i = 0; i != from.word; ++i) {
+                        bytes[i] = p[from.word - 1 - i];
+                    }
+                } else {
+                    std::memcpy(bytes, p, from.word);
+                }
+                if (from.word == 4) {
+                    std::uint32_t w = 0;
+                    std::memcpy(&w, bytes, 4);
+                    v = w;
+                } else {
+                    std::memcpy(&v, bytes, 8);
+                }
+                p += from.word;
+                return true;
+            }
+
+            bool write_word(std::uint64_t v, std::size_t at = std::string::npos) {
+                if (to.word == 4 && v > 0xFFFFFFFFu) {
+                    return fail("Size doesn't fit the target word width.");
+                }
+                char bytes[8];
+                if (to.word == 4) {
+                    const std::uint32_t w = static_cast<std::uint32_t>(v);
+                    std::memcpy(bytes, &w, 4);
+                } else {
+                    std::memcpy(bytes, &v, 8);
+                }
+                if (to.big_endian != (std::endian::native == std::endian::big)) {
+                    std::reverse(bytes, bytes + to.word);
+                }
+                if (at == std::string::npos) {
+                    out.append(bytes, to.word);
+                } else {
+                    out.replace(at, to.word, bytes, to.word);
+                }
+                return true;
+            }
+
+            // Copies numbers of 'size' bytes, swapped when byte orders differ.
+            bool scalars(std::size_t size, std::size_t count) {
+                if (static_cast<std::size_t>(end - p) / size < count) {
+                    return fail("Content is truncated.");
+                }
+                const std::size_t at = out.size();
+                out.append(p, size * count);
+                if (from.big_endian != to.big_endian) {
+                    switch (size) {
+                    case 2: byteswap_elements<2>(out.data() + at, p, count); break;
+                    case 4: byteswap_elements<4>(out.data() + at, p, count); break;
+                    case 8: byteswap_elements<8>(out.data() + at, p, count); break;
+                    }
+                }
+                p += size * count;
+                return true;
+            }
+
+            // Same as parse_binary_type_node but array extents are converted as well.
+            bool signature(binary_type_node& node, std::size_t depth = 0) {
+                if (p == end || depth > 64) {
+                    return fail("Malformed type signature.");
+                }
+                out.push_back(*p);
+                node.identifier = static_cast<std::uint8_t>(*p++);
+                if (node.identifier >= 1 && node.identifier <= 12) {
+                    return true;
+                }
+                if (node.identifier == 0xFF) {
+                    const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p));
+                    if (e == nullptr) {
+                        return fail("Malformed type signature.");
+                    }
+                    out.append(p, e + 1);
+                    p = e + 1;
+                    return true;
+                }
+                if (node.identifier < 13 || node.identifier > 28 || node.identifier == 17 || p == end || *p != '<') {
+                    return fail("Malformed type signature.");
+                }
+                out.push_back(*p++);
+                for (;;) {
+                    if (!signature(node.arguments.emplace_back(), depth + 1)) {
+                        return false;
+                    }
+                    if (node.identifier == 27) {
+                        std::uint64_t extent = 0;
+                        if (p == end || *p != ',') {
+                            return fail("Malformed type signature.");
+                        }
+                        out.push_back(*p++);
+                        if (!read_word(extent) || !write_word(extent)) {
+                            return false;
+                        }
+                        node.extent = static_cast<std::size_t>(extent);
+                    }
+                    if (p == end || (*p != '>' && *p != ',')) {
+                        return fail("Malformed type signature.");
+                    }
+                    out.push_back(*p);
+                    if (*p++ == '>') {
+                        return true;
+                    }
+                }
+            }
+
+            // Marks collect output offsets (relative to base) of every stride-th element of a top level sequence.
+            bool value(const binary_type_node& node, std::vector<std::uint64_t>* marks = nullptr, std::size_t stride = 0, std::size_t base = 0) {
+                const std::uint8_t id = node.identifier;
+                if (id < 12) {
+                    return scalars(binary_fixed_size(node), 1);
+                }
+                if (id == 12) {
+                    if (interned) {
+                        return scalars(sizeof(std::uint32_t), 1);
+                    }
+                    const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p));
+                    if (e == nullptr) {
+                        return fail("Content is truncated.");
+                    }
+                    out.append(p, e + 1);
+                    p = e + 1;
+                    return true;
+                }
+                if (id == 0xFF) {
+                    return fail("Structure values can't be converted, their field types are unknown.");
+                }
+                if (id == 26 || id == 28) {
+                    for (auto& a : node.arguments) {
+                        if (!value(a)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+                std::uint64_t n = node.extent;
+                if (id != 27 && (!read_word(n) || !write_word(n))) {
+                    return false;
+                }
+                const binary_type_node* element = &node.arguments[0];
+                const bool              bulk    = (id < 22 || id == 27) && (element->identifier < 12 || (element->identifier == 12 && interned));
+                const std::size_t       size    = bulk ? binary_fixed_size(*element, interned) : 0;
+                if (size != 0 && marks == nullptr) {
+                    return scalars(size, static_cast<std::size_t>(n));
+                }
+                for (std::uint64_t i = 0; i != n; ++i) {
+                    if (marks != nullptr && i % stride == 0) {
+                        marks->push_back(out.size() - base);
+                    }
+                    if (!value(*element)) {
+                        return false;
+                    }
+                    if (id >= 22 && id <= 25 && !value(node.arguments[1])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // Converts one offset block, returns false at the end mark or on error.
+            bool block() {
+                std::uint64_t word = 0;
+                if (!read_word(word) || word == 0) {
+                    return false;
+                }
+                constexpr unsigned  flag_bits  = std::popcount(static_cast<std::size_t>(offset_block_flag_mask));
+                constexpr unsigned  flag_shift = sizeof(std::size_t) * 8 - flag_bits;
+                const char* const   block_in   = p - from.word;
+                const unsigned      from_shift = from.word * 8 - flag_bits;
+                const std::uint64_t flags      = word >> from_shift;
+                const std::uint64_t size       = word & ((std::uint64_t(1) << from_shift) - 1);
+                if (size > static_cast<std::uint64_t>(end - p)) {
+                    return fail("Content is truncated.");
+                }
+                const char* const block_end  = p + size;
+                const std::uint64_t erased   = (offset_block_erased              >> flag_shift);
+                const std::uint64_t sub      = (offset_block_has_sub_index       >> flag_shift);
+                const std::uint64_t fields   = (offset_block_has_field_directory >> flag_shift);
+                const std::uint64_t strings  = (offset_block_interned_strings    >> flag_shift);
+                const std::uint64_t checksum = (offset_block_has_checksum        >> flag_shift);
+                if (flags & erased) {
+                    p = block_end;
+                    return true;
+                }
+                if (flags & fields) {
+                    return fail("Field directories can't be converted, their structure values are unknown.");
+                }
+                const std::size_t head = out.size();
+                write_word(0);
+                const char* const saved_end = end;
+                end      = block_end;
+                interned = (flags & strings) != 0;
+
+                binary_type_node node;
+                if (!signature(node)) {
+                    return false;
+                }
+                if (node.identifier != 0xFF) {
+                    if (p == end || *p != '\0') {
+                        return fail("Malformed type signature.");
+                    }
+                    out.push_back(*p++);
+                }
+                const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p));
+                if (e == nullptr) {
+                    return fail("Content is truncated.");
+                }
+                out.append(p, e + 1);
+                p = e + 1;
+
+                std::uint64_t count = 0, stride = 0;
+                if (flags & sub) {
+                    if (static_cast<std::size_t>(end - p) < from.word * 2) {
+                        return fail("Content is truncated.");
+                    }
+                    const char* const entries_end = end - from.word * 2;
+                    const char* const value_begin = p;
+                    p = entries_end;
+                    if (!read_word(count) || !read_word(stride) || stride == 0) {
+                        return fail("Malformed sub-index.");
+                    }
+                    p = value_begin;
+                }
+                std::vector<std::uint64_t> marks;
+                const std::size_t          value_out = out.size();
+                if (!value(node, (flags & sub) ? &marks : nullptr, static_cast<std::size_t>(stride), value_out)) {
+                    return false;
+                }
+                // The checksum covers the source bytes, it's recomputed over the converted block at the end.
+                const std::size_t checksum_out = out.size();
+                if (flags & checksum) {
+                    std::uint32_t stored = 0;
+                    if (static_cast<std::size_t>(end - p) < sizeof(std::uint32_t)) {
+                        return fail("Content is truncated.");
+                    }
+                    std::memcpy(&stored, p, sizeof(std::uint32_t));
+                    if (from.big_endian != (std::endian::native == std::endian::big)) {
+                        byteswap_elements<4>(reinterpret_cast<char*>(&stored), p, 1);
+                    }
+                    const char* const rest = p + sizeof(std::uint32_t);
+                    if (crc32c(crc32c(0, block_in, p - block_in), rest, block_end - rest) != stored) {
+                        return fail("Checksum mismatch.");
+                    }
+                    out.append(sizeof(std::uint32_t), '\0');
+                    p = rest;
+                }
+                if (flags & sub) {
+                    if (marks.size() != count || static_cast<std::uint64_t>(end - p) != (count + 2) * from.word) {
+                        return fail("Malformed sub-index.");
+                    }
+                    for (auto m : marks) {
+                        write_word(m);
+                    }
+                    write_word(count);
+                    write_word(stride);
+                    p = end;
+                }
+                if (p != end) {
+                    return fail("Value doesn't match its type signature.");
+                }
+                end = saved_end;
+                const unsigned to_shift = to.word * 8 - flag_bits;
+                const std::uint64_t out_size = out.size() - head - to.word;
+                if (out_size >> to_shift) {
+                    return fail("Size doesn't fit the target word width.");
+                }
+                if (!write_word((flags << to_shift) | out_size, head)) {
+                    return false;
+                }
+                if (flags & checksum) {
+                    const char* const rest = out.data() + checksum_out + sizeof(std::uint32_t);
+                    const std::uint32_t crc = crc32c(crc32c(0, out.data() + head, checksum_out - head), rest, out.data() + out.size() - rest);
+                    if (to.big_endian != (std::endian::native == std::endian::big)) {
+                        byteswap_elements<4>(out.data() + checksum_out, reinterpret_cast<const char*>(&crc), 1);
+                    } else {
+                        std::memcpy(out.data() + checksum_out, &crc, sizeof(std::uint32_t));
+                    }
+                }
+                return true;
+            }
+        };
+
+        // Converts whole compiled content, returns nullptr on success otherwise the reason.
+        inline const char* convert_layout(std::string_view in, binary_layout from, binary_layout to, std::string& out) {
+            if (from == to) {
+                out.assign(in);
+                return nullptr;
+            }
+            layout_converter converter{from, to, in.data(), in.data() + in.size(), out};
+            while (converter.block()) {}
+            if (converter.error != nullptr) {
+                return converter.error;
+            }
+            if (converter.p != converter.end) {
+                return "Trailing bytes after the end mark.";
+            }
+            converter.write_word(0);
+            return nullptr;
+        }
+    }
+
+    inline std::string archive::to_portable(std::string& out) const {
+        archive copy;
+        if (is_journaled()) {
+            copy.content_ = content_;
+            copy.compact();
+        }
+        const std::string_view native = is_journaled() ? std::string_view(copy.content_) : std::string_view(content_);
+        std::string converted;
+        if (const char* msg = details::convert_layout(native, details::host_layout, details::portable_layout, converted)) {
+            return msg;
+        }
+        out.assign(portable_magic).append(converted);
+        return {};
+    }
+
+    inline std::string archive::from_portable(std::string_view portable) {
+        if (!portable.starts_with(portable_magic)) {
+            return "Missing portable magic.";
+        }
+        std::string converted;
+        if (const char* msg = details::convert_layout(portable.substr(portable_magic.size()), details::portable_layout,
+                                                      details::host_layout, converted)) {
+            return msg;
+        }
+        content_ = std::move(converted);
+        return {};
+    }
+
+    inline details::string_table_view archive::string_table() const {
+        const std::string tag   = variable_tag<std::vector<std::string>>(string_table_name);
+        const auto        block = find_offset_block(tag);
+        if (block == content_.cend()) {
+            return {};
+        }
+        const char* const b = &*block;
+        std::size_t offset = 0, count = 0;
+        std::memcpy(&offset, b, sizeof(std::size_t));
+        if ((offset & offset_block_flag_mask & ~offset_block_has_checksum) != offset_block_has_sub_index) {
+            return {};
+        }
+        const char* const block_end = b + sizeof(std::size_t) + (offset & ~offset_block_flag_mask);
+        std::memcpy(&count, block_end - sizeof(std::size_t) * 2, sizeof(std::size_t));
+        return {b + sizeof(std::size_t) + tag.size(), block_end - sizeof(std::size_t) * (count + 2), count};
+    }
+
+    template <class Ty>
+    void archive::read_block_value(std::string::const_iterator block, std::string::const_iterator value, variable_view<Ty> v) const {
+        std::size_t offset = 0;
+        std::memcpy(&offset, &*block, sizeof(std::size_t));
+        if ((v.flag & verify_checksum) && (offset & offset_block_has_checksum) &&
+            !details::verify_block_checksum(&*block + sizeof(std::size_t), &*block + sizeof(std::size_t) + (offset & ~offset_block_flag_mask), offset)) {
+            throw std::runtime_error("Checksum mismatch!");
+        }
+        const bool                       interned = (offset & offset_block_interned_strings) != 0;
+        const details::string_table_view table    = interned ? string_table() : details::string_table_view{};
+        details::string_table_scope      scope(interned ? &table : nullptr);
+        serializer<Ty>{}(value, *v.value, v.flag);
+    }
+
+    template <class Ty>
+    std::string::const_iterator archive::find_field_begin(std::string_view path, std::string::const_iterator* found_block) const {
+        constexpr std::size_t  word     = sizeof(std::size_t);
+        const std::string_view variable = path.substr(0, path.find('.'));
+        const std::string      tag      = variable_tag<Ty>(path.substr(std::min(path.size(), variable.size() + 1)));
+        const char* const      base     = content_.data();
+        for (auto block : alive_offset_blocks()) {
+            std::size_t offset = 0;
+            std::memcpy(&offset, base + block, word);
+            // Only structures have fields, their signatures are '\xFF' followed by a terminated name.
+            const char* p = base + block + word;
+            if ((offset & offset_block_has_field_directory) == 0 || *p != '\xFF') {
+                continue;
+            }
+            p += std::strlen(p) + 1;
+            if (std::string_view(p) != variable) {
+                continue;
+            }
+            const char* const value     = p + variable.size() + 1;
+            const char* const block_end = base + block + word + (offset & ~offset_block_flag_mask);
+            std::size_t directory_size = 0;
+            std::memcpy(&directory_size, block_end - word, word);
+            for (const char* e = block_end - word - directory_size; e != block_end - word;) {
+                std::size_t field = 0;
+                std::memcpy(&field, e, word);
+                e += word;
+                const char* signature = e;
+                details::binary_type_node type;
+                details::parse_binary_type_signature(e, block_end, type);
+                const char* name_end = e + std::strlen(e);
+                if (std::equal(tag.cbegin(), tag.cend(), signature, name_end + 1)) {
+                    if (found_block != nullptr) {
+                        *found_block = content_.cbegin() + static_cast<std::ptrdiff_t>(block);
+                    }
+                    return content_.cbegin() + (value - base) + static_cast<std::ptrdiff_t>(field);
+                }
+                e = name_end + 1;
+            }
+            return content_.cend();
+        }
+        return content_.cend();
+    }
+
+    inline std::string archive::compile_content_default(std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map,
+                                                        compile_options options) noexcept {
+        return compile_content(std::unordered_map<std::string_view, std::string>(init_macro_map.begin(), init_macro_map.end()), options);
+    }
+
+    inline std::string archive::compile_content(std::unordered_map<std::string_view, std::string> macro_map,
+                                                compile_options options) noexcept {
+        std::pmr::memory_resource*       resource = options.resource ? options.resource : std::pmr::get_default_resource();
+        details::counting_memory_resource counting(resource);
+        compile_statistics*              stats    = options.statistics;
+        if (stats != nullptr) {
+            resource = &counting;
+        }
+        cpp_subset_compiler compiler{std::pmr::string(content_, resource), {}, std::pmr::string(resource), options};
+        std::string().swap(content_);
+        cpp_subset_compiler::token_stream stream{compiler};
+
+        // Pass returns its output size, only timed and measured when statistics is requested.
+        auto run_phase = [&](std::string_view name, auto&& pass) {
+            if (stats == nullptr) {
+                pass();
+                return;
+            }
+            const std::size_t input       = compiler.src.size();
+            const std::size_t allocations = counting.allocations;
+            const std::size_t allocated   = counting.allocated_bytes;
+            const auto        begin       = std::chrono::steady_clock::now();
+            const std::size_t output      = pass();
+            stats->phases.push_back({
+                name, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin),
+                input, output, counting.allocations - allocations, counting.allocated_bytes - allocated
+            });
+        };
+
+        // Macro keys are views of this source so keep it alive.
+        std::pmr::string out_source(resource);
+
+        run_phase("remove_comments", [&] {
+            compiler.remove_comments(); compiler.src = compiler.out;
+            return compiler.out.size();
+        });
+        run_phase("macro_definitions", [&] {
+            compiler.get_macro_define_map(macro_map);
+            out_source = std::move(compiler.src);
+            for (auto& i : macro_map) {
+                cpp_subset_compiler::expand_macro_value(macro_map, i.first);
+            }
+            compiler.src = compiler.out;
+            return compiler.out.size();
+        });
+        run_phase("conditional_macros", [&] {
+            compiler.expand_conditional_macros(macro_map); compiler.src = compiler.out;
+            return compiler.out.size();
+        });
+        run_phase("replace_macros", [&] {
+            compiler.replace_remove_macros(macro_map); compiler.src = compiler.out;
+            return compiler.out.size();
+        });
+        run_phase("normalize_string_literals", [&] {
+            compiler.normalize_string_literals(); compiler.src = compiler.out;
+            return compiler.out.size();
+        });
+        run_phase("combine_string_literals", [&] {
+            compiler.combine_string_literals(); compiler.src = compiler.out;
+            return compiler.out.size();
+        });
+        // Tokens are lexed on demand by the code generator.
+        run_phase("generate_byte_code", [&] {
+            compiler.generate_byte_code(stream);
+            return compiler.out.size();
+        });
+        content_.assign(compiler.out.data(), compiler.out.size());
+        if (stats != nullptr) {
+            stats->token_count      = stream.count;
+            stats->macro_expansions = compiler.macro_expansions;
+        }
+        return std::move(compiler.msg);
+    }
+
+    template <std::invocable<std::string_view> Sink>
+    std::string archive::compile_stream(std::istream& in, Sink&& sink,
+                                        std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map,
+                                        compile_options options) {
+        constexpr std::size_t chunk_size = 1 << 16;
+        options.intern_strings = false;  // Table can't go first without holding all output.
+        std::pmr::memory_resource* resource = options.resource ? options.resource : std::pmr::get_default_resource();
+        cpp_subset_compiler        compiler{std::pmr::string(resource), {}, std::pmr::string(resource), options};
+
+        // Macro keys are views, their texts live in macro_keys.
+        std::forward_list<std::string>                    macro_keys;
+        std::unordered_map<std::string_view, std::string> macro_map;
+        for (auto& [key, value] : init_macro_map) {
+            macro_map.insert_or_assign(macro_keys.emplace_front(key), value);
+        }
+        bool active = true;  // False inside a failed #ifdef / #ifndef.
+
+        // Piece is one declaration or one preprocessor line.
+        auto compile_piece = [&](std::string_view piece, bool directive) -> bool {
+            compiler.src.assign(piece);
+            compiler.remove_comments();
+            compiler.src = compiler.out;
+            if (directive) {
+                const auto j = std::find_if_not(compiler.src.begin(), compiler.src.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)) || c == '#'; });
+                const auto k = std::find_if(j, compiler.src.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); });
+                const std::string_view cmd(&*j, k - j);
+                if (cmd == "define" && active) {
+                    std::unordered_map<std::string_view, std::string> defined;
+                    compiler.get_macro_define_map(defined);
+                    for (auto& [key, value] : defined) {
+                        const std::string_view owned = macro_keys.emplace_front(key);
+                        macro_map.insert_or_assign(owned, std::move(value));
+                        cpp_subset_compiler::expand_macro_value(macro_map, owned);
+                    }
+                } else if (cmd == "ifdef" || cmd == "ifndef") {
+                    const auto m = std::find_if_not(k, compiler.src.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); });
+                    const auto n = std::find_if(m, compiler.src.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); });
+                    active = macro_map.contains(std::string_view(&*m, n - m)) == (cmd == "ifdef");
+                } else if (cmd == "endif") {
+                    active = true;
+                }
+                return true;
+            }
+            if (!active) {
+                return true;
+            }
+            compiler.replace_remove_macros(macro_map);          compiler.src = compiler.out;
+            compiler.normalize_string_literals();               compiler.src = compiler.out;
+            if (!compiler) {
+                return false;
+            }
+            compiler.combine_string_literals();                 compiler.src = compiler.out;
+            cpp_subset_compiler::token_stream stream{compiler};
+            compiler.generate_byte_code(stream);
+            if (!compiler) {
+                return false;
+            }
+            if (options.statistics != nullptr) {
+                options.statistics->token_count += stream.count;
+            }
+            // Drop the end mark of this piece, one is written at the end.
+            std::invoke(sink, std::string_view(compiler.out).substr(0, compiler.out.size() - sizeof(std::size_t)));
+            return true;
+        };
+
+        details::declaration_scanner scanner;
+        std::string pending;
+        std::size_t consumed = 0, resume = 0;
+        bool        eof      = false;
+        while (!eof) {
+            const std::size_t old = pending.size();
+            pending.resize(old + chunk_size);
+            in.read(pending.data() + old, chunk_size);
+            pending.resize(old + static_cast<std::size_t>(in.gcount()));
+            eof = !in;
+            for (;;) {
+                bool directive = false;
+                const std::size_t end = scanner.scan(pending, resume, eof, directive);
+                if (scanner.misplaced) {
+                    return "Preprocessor directive inside a declaration is not supported in stream mode.";
+                }
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                if (!compile_piece(std::string_view(pending).substr(consumed, end - consumed), directive)) {
+                    return std::move(compiler.msg);
+                }
+                consumed = end;
+            }
+            // Keep only the unfinished piece.
+            pending.erase(0, consumed);
+            resume  -= consumed;
+            consumed = 0;
+        }
+        if (scanner.has_code) {
+            return "Missing ; after expression.";
+        }
+        if (options.statistics != nullptr) {
+            options.statistics->macro_expansions = compiler.macro_expansions;
+        }
+        constexpr std::size_t end_mark = 0;
+        std::invoke(sink, std::string_view(reinterpret_cast<const char*>(&end_mark), sizeof(std::size_t)));
+        return {};
+    }
+
+    template <class Ty>
+    archive& archive::parallel_read(variable_view<Ty> v, std::size_t thread_count) {
+        static_assert(std::is_same_v<Ty, std::vector<typename Ty::value_type, typename Ty::allocator_type>> ||
+                      std::is_same_v<Ty, std::deque<typename Ty::value_type, typename Ty::allocator_type>>,
+                      "parallel_read only supports std::vector and std::deque.");
+        static_assert(!std::is_same_v<typename Ty::value_type, bool>, "Elements of std::vector<bool> can't be written concurrently.");
+
+        const std::string type_and_name = variable_tag<Ty>(v.name);
+        const auto        block         = find_offset_block(type_and_name);
+        if (block == content_.cend()) {
+            throw std::invalid_argument("Can't find variable name!");
+        }
+        const std::size_t offset      = *reinterpret_cast<const std::size_t*>(&*block);
+        auto              value_begin = block + sizeof(std::size_t) + type_and_name.size();
+        if ((offset & offset_block_has_sub_index) == 0 || thread_count < 2) {
+            read_block_value(block, value_begin, v);
+            return *this;
+        }
+        const bool                       interned = (offset & offset_block_interned_strings) != 0;
+        const details::string_table_view table    = interned ? string_table() : details::string_table_view{};
+
+        const char*       block_end = &*block + sizeof(std::size_t) + (offset & ~offset_block_flag_mask);
+        if ((v.flag & verify_checksum) && (offset & offset_block_has_checksum) &&
+            !details::verify_block_checksum(&*block + sizeof(std::size_t), block_end, offset)) {
+            throw std::runtime_error("Checksum mismatch!");
+        }
+        const std::size_t stride    = *reinterpret_cast<const std::size_t*>(block_end - sizeof(std::size_t));
+        const std::size_t count     = *reinterpret_cast<const std::size_t*>(block_end - sizeof(std::size_t) * 2);
+        const char*       entries   = block_end - sizeof(std::size_t) * (count + 2);
+        const std::size_t n         = *reinterpret_cast<const std::size_t*>(&*value_begin);
+        // Same result as the serial operator>>.
+        const std::size_t base      = (v.flag & read_assign) ? 0 : v.value->size();
+        v.value->resize(base + n);
+
+        std::atomic<std::size_t> next_chunk = 0;
+        std::exception_ptr       error;
+        std::atomic_flag         error_set;
+        auto worker = [&] {
+            try {
+                details::string_table_scope        scope(interned ? &table : nullptr);
+                std_basic_type_binary_input_reader reader{v.flag};
+                for (std::size_t c = next_chunk++; c < count; c = next_chunk++) {
+                    auto        it   = value_begin + *reinterpret_cast<const std::size_t*>(entries + c * sizeof(std::size_t));
+                    std::size_t last = std::min(n, (c + 1) * stride);
+                    for (std::size_t i = c * stride; i != last; ++i) {
+                        details::iterate_std_template_stuff_impl<typename Ty::value_type>{}(it, reader, (*v.value)[base + i], 0);
+                    }
+                }
+            } catch (...) {
+                if (!error_set.test_and_set()) {
+                    error = std::current_exception();
+                }
+            }
+        };
+        {
+            std::vector<std::jthread> workers;
+            for (std::size_t i = 1; i < std::min(thread_count, count); ++i) {
+                workers.emplace_back(worker);
+            }
+            worker();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return *this;
+    }
+
+    inline std::string::const_iterator archive::find_element(std::string_view tag, std::size_t first, std::size_t last, bool& interned,
+                                                             bool verify) const {
+        constexpr std::size_t word  = sizeof(std::size_t);
+        const auto            block = find_offset_block(tag);
+        if (block == content_.cend()) {
+            throw std::invalid_argument("Can't find variable name!");
+        }
+        std::size_t offset = 0;
+        std::memcpy(&offset, &*block, word);
+        const char*       p         = &*block + word;
+        const char* const block_end = p + (offset & ~offset_block_flag_mask);
+        const char*       value_end = block_end;
+        if (verify && (offset & offset_block_has_checksum) && !details::verify_block_checksum(&*block + word, block_end, offset)) {
+            throw std::runtime_error("Checksum mismatch!");
+        }
+        details::binary_type_node type;
+        details::parse_binary_type_signature(p, block_end, type);
+        const char* const value = &*block + word + tag.size();
+
+        std::size_t n = 0;
+        std::memcpy(&n, value, word);
+        if (first > last || last > n) {
+            throw std::out_of_range("Element range exceeds container size!");
+        }
+        std::size_t index_count = 0, stride = 0;
+        const char* entries = nullptr;
+        if (offset & offset_block_has_sub_index) {
+            std::memcpy(&stride,      block_end - word,     word);
+            std::memcpy(&index_count, block_end - word * 2, word);
+            entries   = block_end - word * (index_count + 2);
+            value_end = entries;
+        }
+        if (offset & offset_block_has_checksum) {
+            value_end -= sizeof(std::uint32_t);
+        }
+
+        interned = (offset & offset_block_interned_strings) != 0;
+        const details::string_table_view table = interned ? string_table() : details::string_table_view{};
+        const details::binary_type_node& element = type.arguments[0];
+        if (const std::size_t k = details::binary_fixed_size(element, interned); k != 0) {
+            return block + (value - &*block) + static_cast<std::ptrdiff_t>(word + first * k);
+        }
+        const char* e    = value + word;
+        std::size_t skip = first;
+        if (stride != 0 && first >= stride && first < n) {
+            std::size_t entry = 0;
+            std::memcpy(&entry, entries + first / stride * word, word);
+            e    = value + entry;
+            skip = first % stride;
+        }
+        for (; skip != 0 && e != nullptr; --skip) {
+            e = details::walk_binary_value(element, e, value_end, interned ? &table : nullptr);
+        }
+        if (e == nullptr) {
+            throw std::invalid_argument("Value doesn't match its type signature!");
+        }
+        return block + (e - &*block);
+    }
+
+    template <class Ty>
+    archive& archive::read_range(variable_view<Ty> v, std::size_t first, std::size_t last) {
+        static_assert(details::std_template_library_type_traits<Ty>::is_mono && details::std_template_library_type_traits<Ty>::is_resizeable,
+                      "read_range only supports sequential containers.");
+        using element = typename Ty::value_type;
+        bool interned = false;
+        auto it       = find_element(variable_tag<Ty>(v.name), first, last, interned, (v.flag & verify_checksum) != 0);
+        const details::string_table_view table = interned ? string_table() : details::string_table_view{};
+        details::string_table_scope      scope(interned ? &table : nullptr);
+        if constexpr (details::contiguous_binary_range<Ty>) {
+            const std::size_t old = v.value->size();
+            v.value->resize(old + (last - first));
+            std::memcpy(v.value->data() + old, &*it, (last - first) * sizeof(element));
+        } else {
+            std_basic_type_binary_input_reader reader{v.flag};
+            auto inserter = std::inserter(*v.value, v.value->end());
+            for (std::size_t i = first; i != last; ++i) {
+                auto cache = details::make_element_of<element>(*v.value);
+                details::iterate_std_template_stuff_impl<element>{}(it, reader, cache, 0);
+                *inserter++ = std::move(cache);
+            }
+        }
+        return *this;
+    }
+
+    template <class Ty, std::size_t Extent>
+    archive& archive::read_range(std::string_view var_name, std::span<Ty, Extent> out, std::size_t first, flag_t flag) {
+        std::string tag = variable_tag<std::vector<Ty>>(var_name);
+        if (find_offset_block(tag) == content_.cend()) {
+            tag = variable_tag<std::deque<Ty>>(var_name);
+        }
+        bool interned = false;
+        auto it       = find_element(tag, first, first + out.size(), interned, (flag & verify_checksum) != 0);
+        const details::string_table_view table = interned ? string_table() : details::string_table_view{};
+        details::string_table_scope      scope(interned ? &table : nullptr);
+        if constexpr (details::binary_layout_compatible<Ty>::value) {
+            std::memcpy(out.data(), &*it, out.size_bytes());
+        } else {
+            std_basic_type_binary_input_reader reader{flag};
+            for (auto& i : out) {
+                details::iterate_std_template_stuff_impl<Ty>{}(it, reader, i, 0);
+            }
+        }
+        return *this;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///                                    Stream reader
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Forward only reader of compiled content from a stream, one top level variable at a time, so archives
+    // larger than memory can be processed in one pass. Only the current offset block is held in memory and
+    // skipped values are not read at all (seeked over when the stream supports it). Journaled archives must be
+    // compacted first, erased blocks are skipped. The string table is kept when it's passed and not yielded.
+    //
+    //     cpod::stream_reader r(file);
+    //     while (r.next()) {
+    //         if (r.is<std::vector<int>>()) { r.read(values); }
+    //     }
+    class stream_reader {
+        std::istream&             in_;
+        std::string               block_;           // Head of current block and as much of its value as read so far.
+        std::size_t               remaining_ = 0;   // Bytes of current block still in the stream.
+        std::size_t               value_     = 0;   // Value begin inside block_.
+        std::size_t               offset_    = 0;
+        details::binary_type_node type_;
+        std::size_t               name_      = 0;   // Name begin inside block_, it ends right before value_.
+        std::string               strings_block_;   // String table block, see compile_options::intern_strings.
+        details::string_table_view strings_;
+
+        // Reads n more bytes of the current block.
+        // Growing block_ may move it, so structure name of type_ (right after '\xFF') is pointed at it again.
+        void fetch(std::size_t n) {
+            const std::size_t old = block_.size();
+            block_.resize(old + n);
+            if (type_.identifier == 0xFF) {
+                type_.name = std::string_view(block_.data() + 1, type_.name.size());
+            }
+            in_.read(block_.data() + old, static_cast<std::streamsize>(n));
+            if (static_cast<std::size_t>(in_.gcount()) != n) {
+                throw std::runtime_error("Unexpected end of archive stream!");
+            }
+            remaining_ -= n;
+        }
+
+        void skip_rest() {
+            if (remaining_ != 0 && !in_.seekg(static_cast<std::streamoff>(remaining_), std::ios_base::cur)) {
+                in_.clear();
+                in_.ignore(static_cast<std::streamsize>(remaining_));
+            }
+            remaining_ = 0;
+        }
+
+    public:
+        explicit stream_reader(std::istream& in) : in_(in) {}
+
+        // Moves to the next variable, returns false at the end mark.
+        bool next() {
+            skip_rest();
+            for (;;) {
+                if (!in_.read(reinterpret_cast<char*>(&offset_), sizeof(std::size_t)) || offset_ == 0) {
+                    return false;
+                }
+                remaining_ = offset_ & ~offset_block_flag_mask;
+                if (offset_ & offset_block_erased) {
+                    skip_rest();
+                    continue;
+                }
+                // Head length is unknown (array extents are raw bytes), read more until it parses.
+                block_.clear();
+                type_ = {};
+                for (std::size_t want = 64;; want *= 2) {
+                    fetch(std::min(want - block_.size(), remaining_));
+                    const char* p   = block_.data();
+                    const char* end = block_.data() + block_.size();
+                    type_ = {};
+                    if (details::parse_binary_type_signature(p, end, type_)) {
+                        if (const char* e = static_cast<const char*>(std::memchr(p, '\0', end - p))) {
+                            name_  = static_cast<std::size_t>(p - block_.data());
+                            value_ = static_cast<std::size_t>(e + 1 - block_.data());
+                            break;
+                        }
+                    }
+                    if (remaining_ == 0) {
+                        throw std::runtime_error("Invalid offset block in archive stream!");
+                    }
+                }
+                if (!is<std::vector<std::string>>() || name() != archive::string_table_name) {
+                    return true;
+                }
+                if ((offset_ & offset_block_flag_mask & ~offset_block_has_checksum) != offset_block_has_sub_index) {
+                    throw std::runtime_error("Invalid string table in archive stream!");
+                }
+                fetch(remaining_);
+                strings_block_.swap(block_);
+                const char* block_end = strings_block_.data() + strings_block_.size();
+                std::memcpy(&strings_.count, block_end - sizeof(std::size_t) * 2, sizeof(std::size_t));
+                strings_.value   = strings_block_.data() + value_;
+                strings_.entries = block_end - sizeof(std::size_t) * (strings_.count + 2);
+            }
+        }
+
+        std::string_view                 name()      const { return std::string_view(block_).substr(name_, value_ - 1 - name_); }
+        // Type signature followed by the name, same as archive::variable_tag.
+        std::string_view                 tag()       const { return std::string_view(block_).substr(0, value_); }
+        const details::binary_type_node& type()      const { return type_; }
+        std::size_t                      size()      const { return (offset_ & ~offset_block_flag_mask) - value_; }
+
+        template <class Ty>
+        bool is() const { return tag() == archive::variable_tag<Ty>(name()); }
+
+        // Decodes current variable, Ty must match its signature.
+        template <class Ty>
+        void read(Ty& value, flag_t flag = {}) {
+            if (!is<Ty>()) {
+                throw std::invalid_argument("Type doesn't match the variable!");
+            }
+            const bool interned = (offset_ & offset_block_interned_strings) != 0;
+            if (interned && strings_.value == nullptr) {
+                throw std::runtime_error("Missing string table in archive stream!");
+            }
+            fetch(remaining_);
+            if ((flag & verify_checksum) && (offset_ & offset_block_has_checksum) &&
+                !details::verify_block_checksum(block_.data(), block_.data() + block_.size(), offset_)) {
+                throw std::runtime_error("Checksum mismatch!");
+            }
+            std::string::const_iterator it = block_.cbegin() + static_cast<std::ptrdiff_t>(value_);
+            details::string_table_scope scope(interned ? &strings_ : nullptr);
+            serializer<Ty>{}(it, value, flag);
+        }
+
+        // Skips current variable without reading its value, next() does this too.
+        void skip() { skip_rest(); }
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///                                         Snapshot
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Immutable compiled content, every member is const so any number of threads may read one snapshot (or its
+    // copies, which share the content) at the same time without locking. Lookups go through an index from variable
+    // tags to blocks which is built once on first use under std::call_once, so it's published to all readers safely.
+    // Like archive reads, untrusted content should pass validate() first.
+    class snapshot {
+        struct state {
+            archive                                                     arch;
+            mutable std::once_flag                                      indexed;
+            mutable std::unordered_map<std::string_view, std::size_t>   blocks;   // Variable tag to its offset word.
+            mutable details::string_table_view                          strings{};
+
+            explicit state(archive&& a) : arch(std::move(a)) {}
+        };
+        std::shared_ptr<const state> state_;
+
+        const state& indexed() const {
+            std::call_once(state_->indexed, [s = state_.get()] {
+                const std::string_view content = s->arch.content();
+                for (auto block : s->arch.alive_offset_blocks()) {
+                    const char*               tag = content.data() + block + sizeof(std::size_t);
+                    const char*               p   = tag;
+                    details::binary_type_node node;
+                    if (!details::parse_binary_type_signature(p, content.data() + content.size(), node)) {
+                        break;
+                    }
+                    const char* e = static_cast<const char*>(std::memchr(p, '\0', content.data() + content.size() - p));
+                    if (e == nullptr) {
+                        break;
+                    }
+                    s->blocks.emplace(std::string_view(tag, e + 1 - tag), block);
+                }
+                s->strings = s->arch.string_table();
+            });
+            return *state_;
+        }
+
+    public:
+        explicit snapshot(archive&& arch) : state_(std::make_shared<const state>(std::move(arch))) {}
+        explicit snapshot(std::string_view content) : snapshot(archive(content)) {}
+
+        std::string_view content()  const { return state_->arch.content(); }
+        std::string      validate() const noexcept { return state_->arch.validate(); }
+
+        template <class Ty>
+        bool contains(std::string_view var_name) const {
+            return indexed().blocks.contains(archive::variable_tag<Ty>(var_name));
+        }
+
+        // Same as archive::operator>>, dotted paths of structures compiled with field directories are supported.
+        template <class Ty>
+        const snapshot& operator>>(variable_view<Ty> v) const {
+            const state&      s             = indexed();
+            const std::string type_and_name = archive::variable_tag<Ty>(v.name);
+            if (auto found = s.blocks.find(type_and_name); found != s.blocks.end()) {
+                auto block = s.arch.content_.cbegin() + static_cast<std::ptrdiff_t>(found->second);
+                auto value = block + static_cast<std::ptrdiff_t>(sizeof(std::size_t) + type_and_name.size());
+                std::size_t offset = 0;
+                std::memcpy(&offset, &*block, sizeof(std::size_t));
+                if ((v.flag & verify_checksum) && (offset & offset_block_has_checksum) &&
+                    !details::verify_block_checksum(&*block + sizeof(std::size_t),
+                                                    &*block + sizeof(std::size_t) + (offset & ~offset_block_flag_mask), offset)) {
+                    throw std::runtime_error("Checksum mismatch!");
+                }
+                details::string_table_scope scope((offset & offset_block_interned_strings) ? &s.strings : nullptr);
+                serializer<Ty>{}(value, *v.value, v.flag);
+                return *this;
+            }
+            if (v.name.find('.') != std::string_view::npos) {
+                std::string::const_iterator block;
+                if (auto it = s.arch.find_field_begin<Ty>(v.name, &block); it != s.arch.content_.cend()) {
+                    s.arch.read_block_value(block, it, v);
+                    return *this;
+                }
+            }
+            throw std::invalid_argument("Can't find variable name!");
+        }
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///                                         Reloader
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Watches a text source file (inotify on Linux, modification time polling elsewhere) and recompiles it on every
+    // change, each successful compile is published as a new snapshot. A failed compile keeps the current snapshot,
+    // its reason is kept in last_error(). Readers never block nor lock: the current snapshot is swapped atomically and
+    // protected by hazard pointers, old ones are freed by the reloading thread once no reader points to them.
+    // Readers must not outlive the reloader.
+    class reloader {
+        // One per concurrent reader, records are reused and only freed with the reloader.
+        struct hazard {
+            std::atomic<const snapshot*> pointer{nullptr};
+            std::atomic<bool>            active{false};
+            hazard*                      next = nullptr;
+        };
+
+        std::filesystem::path                            path_;
+        std::vector<std::pair<std::string, std::string>> macros_;
+        compile_options                                  options_;
+        std::atomic<const snapshot*>                     current_{nullptr};
+        mutable std::atomic<hazard*>                     hazards_{nullptr};
+        std::atomic<std::size_t>                         generation_{0};
+        // Below are only touched by reloads.
+        std::mutex                                       reload_mutex_;
+        std::vector<const snapshot*>                     retired_;
+        std::string                                      error_;
+        // Set up before the first compile so that no change after it is missed.
+        int                                              inotify_ = -1;
+        std::filesystem::file_time_type                  last_write_;
+        std::jthread                                     watcher_;
+
+        hazard* acquire_hazard() const {
+            for (hazard* h = hazards_.load(std::memory_order_acquire); h != nullptr; h = h->next) {
+                bool idle = false;
+                if (!h->active.load(std::memory_order_relaxed) && h->active.compare_exchange_strong(idle, true, std::memory_order_acquire)) {
+                    return h;
+                }
+            }
+            hazard* h = new hazard;
+            h->active.store(true, std::memory_order_relaxed);
+            h->next = hazards_.load(std::memory_order_relaxed);
+            while (!hazards_.compare_exchange_weak(h->next, h, std::memory_order_release, std::memory_order_relaxed)) {}
+            return h;
+        }
+
+        // Frees retired snapshots no reader points to, called with reload_mutex_ held.
+        void reclaim() {
+            std::vector<const snapshot*> in_use;
+            for (hazard* h = hazards_.load(std::memory_order_acquire); h != nullptr; h = h->next) {
+                in_use.push_back(h->pointer.load());
+            }
+            std::erase_if(retired_, [&](const snapshot* s) {
+                if (std::ranges::find(in_use, s) != in_use.end()) {
+                    return false;
+                }
+                delete s;
+                return true;
+            });
+        }
+
+        void start_watching() {
+#if defined(__linux__)
+            // Directory is watched since editors often replace the file instead of writing it. Only finished writes
+            // and renames into place count, a file just created (IN_CREATE) may still be empty.
+            inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotify_ >= 0) {
+                const std::filesystem::path dir = path_.has_parent_path() ? path_.parent_path() : std::filesystem::path(".");
+                if (::inotify_add_watch(inotify_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+                    ::close(std::exchange(inotify_, -1));
+                }
             }
-            offset_block += static_cast<std::size_t>(offset);
+#endif
+            std::error_code ec;
+            last_write_ = std::filesystem::last_write_time(path_, ec);
         }
-        return content_.cend();
-    }
-    
-    inline std::string archive::compile_content_default(std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map) noexcept {
-        cpp_subset_compiler compiler(std::move(content_));
-        std::vector<std::string_view>                     token_list;
-        std::unordered_map<std::string_view, std::string> macro_map(init_macro_map.begin(), init_macro_map.end());
 
-        compiler.remove_comments(); compiler.src = compiler.out;             
-        compiler.get_macro_define_map(macro_map);
-        std::string out_source = std::move(compiler.src);
+        void watch(std::stop_token stop) {
+            constexpr int interval_ms = 100;  // Longest delay of noticing stop.
+#if defined(__linux__)
+            if (inotify_ >= 0) {
+                const std::string name = path_.filename().string();
+                alignas(inotify_event) char events[4096];
+                while (!stop.stop_requested()) {
+                    pollfd p{inotify_, POLLIN, 0};
+                    if (::poll(&p, 1, interval_ms) <= 0) {
+                        continue;
+                    }
+                    bool changed = false;
+                    for (ssize_t n; (n = ::read(inotify_, events, sizeof(events))) > 0;) {
+                        for (char* e = events; e < events + n; e += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(e)->len) {
+                            const inotify_event* event = reinterpret_cast<inotify_event*>(e);
+                            changed |= event->len != 0 && name == event->name;
+                        }
+                    }
+                    if (changed) {
+                        reload();
+                    }
+                }
+                return;
+            }
+#endif
+            std::error_code ec;
+            while (!stop.stop_requested()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+                const auto time = std::filesystem::last_write_time(path_, ec);
+                if (!ec && time != last_write_) {
+                    last_write_ = time;
+                    reload();
+                }
+            }
+        }
+
+    public:
+        // Protects one snapshot from being freed while it's alive, acquiring and releasing it are lock free.
+        class reader {
+            friend class reloader;
+            hazard*         hazard_;
+            const snapshot* snapshot_;
+
+            reader(hazard* h, const snapshot* s) : hazard_(h), snapshot_(s) {}
+        public:
+            reader(const reader&)            = delete;
+            reader& operator=(const reader&) = delete;
+            ~reader() {
+                hazard_->pointer.store(nullptr, std::memory_order_release);
+                hazard_->active.store(false, std::memory_order_release);
+            }
+
+            const snapshot& operator*()  const { return *snapshot_; }
+            const snapshot* operator->() const { return snapshot_; }
+        };
 
-        for (auto& i : macro_map) {
-            cpp_subset_compiler::expand_macro_value(macro_map, i.first);
+        // Source is compiled once before returning, throws std::runtime_error with the reason if it fails.
+        explicit reloader(std::filesystem::path source,
+                          std::initializer_list<std::pair<std::string_view, std::string>> init_macro_map = {},
+                          compile_options options = {})
+            : path_(std::move(source)), options_(options) {
+            options_.statistics = nullptr;  // Reloads happen on another thread.
+            for (auto& [key, value] : init_macro_map) {
+                macros_.emplace_back(key, value);
+            }
+            start_watching();
+            if (std::string msg = reload(); !msg.empty()) {
+#if defined(__linux__)
+                if (inotify_ >= 0) {
+                    ::close(inotify_);
+                }
+#endif
+                throw std::runtime_error(msg);
+            }
+            watcher_ = std::jthread([this](std::stop_token stop) { watch(stop); });
         }
 
-        compiler.src = compiler.out; compiler.expand_conditional_macros(macro_map);
-        compiler.src = compiler.out; compiler.replace_remove_macros(macro_map);
-        compiler.src = compiler.out; compiler.normalize_string_literals();
-        compiler.src = compiler.out; compiler.combine_string_literals();
-        compiler.src = compiler.out;
-        
-        compiler.tokenize_source(std::back_inserter(token_list));
-        compiler.generate_byte_code(token_list);
-        content_ = compiler.out;
-        return std::move(compiler.msg);
+        reloader(const reloader&)            = delete;
+        reloader& operator=(const reloader&) = delete;
+
+        ~reloader() {
+            watcher_.request_stop();
+            if (watcher_.joinable()) {
+                watcher_.join();
+            }
+#if defined(__linux__)
+            if (inotify_ >= 0) {
+                ::close(inotify_);
+            }
+#endif
+            delete current_.load();
+            for (auto s : retired_) {
+                delete s;
+            }
+            for (hazard* h = hazards_.load(); h != nullptr;) {
+                delete std::exchange(h, h->next);
+            }
+        }
+
+        // Current snapshot, reading through it never waits for reloads.
+        reader read() const {
+            hazard*         h = acquire_hazard();
+            const snapshot* s = current_.load();
+            for (const snapshot* again = nullptr; ; s = again) {
+                h->pointer.store(s);
+                if ((again = current_.load()) == s) {
+                    break;
+                }
+            }
+            return reader(h, s);
+        }
+
+        // Copy of the current snapshot, it shares the content and stays valid after later reloads.
+        snapshot current() const { return *read(); }
+
+        // Increases on every published snapshot.
+        std::size_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+        // Recompiles the source now, returns an empty string on success otherwise the reason.
+        std::string reload() {
+            std::ifstream   in(path_, std::ios::binary);
+            std::lock_guard lock(reload_mutex_);
+            if (!in) {
+                return error_ = "Can't open source file!";
+            }
+            archive arch;
+            arch.content().assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            std::unordered_map<std::string_view, std::string> macro_map;
+            for (auto& [key, value] : macros_) {
+                macro_map.insert_or_assign(key, value);
+            }
+            if (std::string msg = arch.compile_content(std::move(macro_map), options_); !msg.empty()) {
+                return error_ = std::move(msg);
+            }
+            if (const snapshot* old = current_.exchange(new snapshot(std::move(arch)))) {
+                retired_.push_back(old);
+            }
+            generation_.fetch_add(1, std::memory_order_release);
+            error_.clear();
+            reclaim();
+            return {};
+        }
+
+        std::string last_error() {
+            std::lock_guard lock(reload_mutex_);
+            return error_;
+        }
+    };
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///                                       Batch loading
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    struct load_options {
+        // Most reads in flight at once, entries of the io_uring queue or threads of the fallback pool.
+        std::size_t queue_depth = 64;
+        // Always use the thread pool even where io_uring is available.
+        bool        thread_pool = false;
+    };
+
+    namespace details {
+
+        // Reads a whole file with std::ifstream, returns an empty string on success otherwise the reason.
+        inline std::string read_whole_file(const std::filesystem::path& path, std::string& out) {
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(path, ec)) {
+                return ec ? "Can't open file!" : "Not a regular file!";
+            }
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) {
+                return "Can't open file!";
+            }
+            const std::streamsize size = in.tellg();
+            if (size < 0) {
+                return "Can't read file!";
+            }
+            out.resize(static_cast<std::size_t>(size));
+            if (!in.seekg(0) || !in.read(out.data(), size)) {
+                return "Can't read file!";
+            }
+            return {};
+        }
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+        // Only what batch loading needs from io_uring: readv requests and their completions. valid() is false
+        // when the kernel doesn't provide it (older than 5.1, disabled, or blocked by seccomp).
+        class io_uring_queue {
+            int           fd_        = -1;
+            void*         sq_ring_   = MAP_FAILED;
+            void*         cq_ring_   = MAP_FAILED;
+            void*         sqes_      = MAP_FAILED;
+            std::size_t   sq_size_   = 0, cq_size_ = 0, sqes_size_ = 0;
+            unsigned*     sq_tail_   = nullptr;
+            unsigned*     sq_mask_   = nullptr;
+            unsigned*     sq_array_  = nullptr;
+            unsigned*     cq_head_   = nullptr;
+            unsigned*     cq_tail_   = nullptr;
+            unsigned*     cq_mask_   = nullptr;
+            io_uring_cqe* cqes_      = nullptr;
+            unsigned      queued_    = 0;   // Requests not yet submitted.
+
+            template <class Ty>
+            static Ty* at(void* ring, std::uint32_t offset) {
+                return reinterpret_cast<Ty*>(static_cast<char*>(ring) + offset);
+            }
+
+            void release() {
+                if (sqes_ != MAP_FAILED) {
+                    ::munmap(sqes_, sqes_size_);
+                }
+                if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+                    ::munmap(cq_ring_, cq_size_);
+                }
+                if (sq_ring_ != MAP_FAILED) {
+                    ::munmap(sq_ring_, sq_size_);
+                }
+                if (fd_ >= 0) {
+                    ::close(fd_);
+                }
+                fd_ = -1;
+            }
+
+        public:
+            explicit io_uring_queue(unsigned entries) {
+                io_uring_params params{};
+                fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                if (fd_ < 0) {
+                    return;
+                }
+                sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                // Both rings share one mapping since 5.4.
+                const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single) {
+                    sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+                }
+                sq_ring_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+                cq_ring_ = single ? sq_ring_ :
+                           ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+                sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+                sqes_      = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+                if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+                    release();
+                    return;
+                }
+                sq_tail_  = at<unsigned>(sq_ring_, params.sq_off.tail);
+                sq_mask_  = at<unsigned>(sq_ring_, params.sq_off.ring_mask);
+                sq_array_ = at<unsigned>(sq_ring_, params.sq_off.array);
+                cq_head_  = at<unsigned>(cq_ring_, params.cq_off.head);
+                cq_tail_  = at<unsigned>(cq_ring_, params.cq_off.tail);
+                cq_mask_  = at<unsigned>(cq_ring_, params.cq_off.ring_mask);
+                cqes_     = at<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+            }
+
+            io_uring_queue(const io_uring_queue&)            = delete;
+            io_uring_queue& operator=(const io_uring_queue&) = delete;
+            ~io_uring_queue() { release(); }
+
+            bool valid() const { return fd_ >= 0; }
+
+            // Queues a read into vec (which must live until its completion), user_data comes back with the completion.
+            // Callers keep at most 'entries' requests in flight.
+            void read(int file, const iovec* vec, std::uint64_t offset, std::uint64_t user_data) {
+                const unsigned tail  = *sq_tail_;
+                const unsigned index = tail & *sq_mask_;
+                io_uring_sqe&  sqe   = static_cast<io_uring_sqe*>(sqes_)[index];
+                sqe           = {};
+                sqe.opcode    = IORING_OP_READV;
+                sqe.fd        = file;
+                sqe.addr      = reinterpret_cast<std::uint64_t>(vec);
+                sqe.len       = 1;
+                sqe.off       = offset;
+                sqe.user_data = user_data;
+                sq_array_[index] = index;
+                std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+                ++queued_;
+            }
+
+            // Submits queued requests and waits for at least one completion, false if the kernel refuses.
+            bool submit_and_wait() {
+                for (;;) {
+                    const long n = ::syscall(__NR_io_uring_enter, fd_, queued_, 1u, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if (n >= 0) {
+                        queued_ -= static_cast<unsigned>(n);
+                        return true;
+                    }
+                    if (errno != EINTR) {
+                        return false;
+                    }
+                }
+            }
+
+            // Calls f(user_data, result) for every available completion.
+            template <class F>
+            void completions(F&& f) {
+                unsigned       head = *cq_head_;
+                const unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+                for (; head != tail; ++head) {
+                    const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+                    f(cqe.user_data, cqe.res);
+                }
+                std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+            }
+        };
+
+        // Loads through io_uring, false if it's unavailable or a submission fails midway. Some files may be loaded
+        // (or have errors) then, the caller reads them all again.
+        inline bool load_with_io_uring(std::span<const std::filesystem::path> paths, std::vector<archive>& archives,
+                                       std::vector<std::string>& errors, std::size_t queue_depth) {
+            // Longest single request, the rest of a file is read by following requests.
+            constexpr std::size_t max_request = std::size_t(1) << 30;
+            struct slot {
+                std::size_t file = 0;
+                int         fd   = -1;
+                std::size_t done = 0;
+                iovec       vec{};
+            };
+            const std::size_t depth = std::min<std::size_t>(queue_depth, 4096);
+            io_uring_queue    queue(static_cast<unsigned>(depth));
+            if (!queue.valid()) {
+                return false;
+            }
+            std::vector<slot>        slots(depth);
+            std::vector<std::size_t> idle(depth);
+            for (std::size_t i = 0; i != depth; ++i) {
+                idle[i] = depth - 1 - i;
+            }
+            auto request = [&](std::size_t s) {
+                slot&        sl   = slots[s];
+                std::string& data = archives[sl.file].content();
+                sl.vec = {data.data() + sl.done, std::min(data.size() - sl.done, max_request)};
+                queue.read(sl.fd, &sl.vec, sl.done, s);
+            };
+            auto finish = [&](std::size_t s) {
+                ::close(std::exchange(slots[s].fd, -1));
+                idle.push_back(s);
+            };
+
+            std::size_t next = 0;
+            while (next != paths.size() || idle.size() != depth) {
+                // Open files until the queue is full, empty ones need no read.
+                while (next != paths.size() && !idle.empty()) {
+                    const std::size_t i  = next++;
+                    const int         fd = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+                    struct stat       st{};
+                    if (fd < 0) {
+                        errors[i] = "Can't open file!";
+                        continue;
+                    }
+                    if (::fstat(fd, &st) != 0) {
+                        ::close(fd);
+                        errors[i] = "Can't read file!";
+                        continue;
+                    }
+                    if (!S_ISREG(st.st_mode)) {
+                        ::close(fd);
+                        errors[i] = "Not a regular file!";
+                        continue;
+                    }
+                    try {
+                        archives[i].content().resize(static_cast<std::size_t>(st.st_size));
+                    } catch (const std::exception& e) {
+                        ::close(fd);
+                        errors[i] = e.what();
+                        continue;
+                    }
+                    if (st.st_size == 0) {
+                        ::close(fd);
+                        continue;
+                    }
+                    const std::size_t s = idle.back();
+                    idle.pop_back();
+                    slots[s] = {i, fd, 0, {}};
+                    request(s);
+                }
+                if (idle.size() == depth) {
+                    continue;
+                }
+                if (!queue.submit_and_wait()) {
+                    for (auto& sl : slots) {
+                        if (sl.fd >= 0) {
+                            ::close(sl.fd);
+                        }
+                    }
+                    return false;
+                }
+                queue.completions([&](std::uint64_t s, int result) {
+                    slot&        sl   = slots[s];
+                    std::string& data = archives[sl.file].content();
+                    if (result == -EINTR || result == -EAGAIN) {
+                        request(s);
+                    } else if (result < 0) {
+                        errors[sl.file] = "Can't read file!";
+                        finish(s);
+                    } else if (result == 0) {
+                        // File shrank after its size was taken.
+                        data.resize(sl.done);
+                        finish(s);
+                    } else if ((sl.done += static_cast<std::size_t>(result)) != data.size()) {
+                        request(s);
+                    } else {
+                        finish(s);
+                    }
+                });
+            }
+            return true;
+        }
+#endif
+    }
+
+    // Reads many compiled archive files at once so that cold start I/O is bound by the queue depth instead of
+    // being serial. On Linux reads are submitted together through io_uring (raw syscalls, no liburing), where it's
+    // unavailable (other systems, old kernels, seccomp) a pool of threads reads them. archives[i] holds file i and
+    // errors[i] is empty on success otherwise the reason. Like reads of any archive, untrusted files should pass
+    // validate() first.
+    inline std::vector<std::string> load_archives(std::span<const std::filesystem::path> paths, std::vector<archive>& archives,
+                                                  load_options options = {}) {
+        std::vector<std::string> errors(paths.size());
+        archives.clear();
+        archives.resize(paths.size());
+        const std::size_t depth = std::max<std::size_t>(options.queue_depth, 1);
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+        if (!options.thread_pool && !paths.empty() && details::load_with_io_uring(paths, archives, errors, depth)) {
+            return errors;
+        }
+#endif
+        std::atomic<std::size_t> next = 0;
+        auto worker = [&] {
+            for (std::size_t i = next++; i < paths.size(); i = next++) {
+                // An exception escaping a jthread terminates, so it becomes the error of its file.
+                try {
+                    errors[i] = details::read_whole_file(paths[i], archives[i].content());
+                } catch (const std::exception& e) {
+                    archives[i].content().clear();
+                    errors[i] = e.what();
+                }
+            }
+        };
+        {
+            std::vector<std::jthread> pool;
+            for (std::size_t i = 1; i < std::min(depth, paths.size()); ++i) {
+                pool.emplace_back(worker);
+            }
+            worker();
+        }
+        return errors;
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1312,11 +5021,448 @@ template <typename K, typename V, typename ... OtherStuff> \
         }
     };
 
+    // Describes one member of a structure for structure_serializer.
+    template <class Ty, class Member>
+    struct field_view {
+        std::string_view name;
+        Member Ty::*     pointer;
+    };
+
+    template <class Ty, class Member>
+    constexpr auto field(std::string_view name, Member Ty::* pointer) {
+        return field_view<Ty, Member>{name, pointer};
+    }
+
+    // Derive a serializer from this and provide 'type_name' and 'fields()' (a tuple of cpod::field),
+    // then text writer, binary writer and binary reader are all generated from the same field list.
+    template <class Ty, bool IsClass = false>
+    struct structure_serializer {
+        constexpr void operator()(archive& arch, std::string_view name, const Ty& v, flag_t flag) const {
+            auto_structure_description_writer<Ty, IsClass> sw(arch, name);
+            std::apply([&](const auto& ... f) {
+                ((serializer<std::remove_cvref_t<decltype(v.*f.pointer)>>{}(arch, f.name, v.*f.pointer, flag & ~flag_t(constant_initialized)), arch << '\n'), ...);
+            }, serializer<Ty>::fields());
+        }
+        constexpr void operator()(std::string::const_iterator& mem_begin, Ty& v, flag_t flag) const {
+            std::apply([&](const auto& ... f) {
+                (serializer<std::remove_cvref_t<decltype(v.*f.pointer)>>{}(mem_begin, v.*f.pointer, flag), ...);
+            }, serializer<Ty>::fields());
+        }
+        constexpr void operator()(std::string& buf, const Ty& v, flag_t flag) const {
+            std::apply([&](const auto& ... f) {
+                (serializer<std::remove_cvref_t<decltype(v.*f.pointer)>>{}(buf, v.*f.pointer, flag), ...);
+            }, serializer<Ty>::fields());
+        }
+    };
+
+    template <class Ty>
+    archive& archive::write_binary(variable_view<Ty> v) {
+        if (is_journaled()) {
+            return append(v);
+        }
+        // Drop the end mark, it's appended again after the new block.
+        if (content_.size() >= sizeof(std::size_t)) {
+            content_.resize(content_.size() - sizeof(std::size_t));
+        }
+        const std::size_t head = content_.size();
+        content_.append(sizeof(std::size_t), '\0');
+        content_.append(variable_tag<Ty>(v.name));
+        serializer<Ty>{}(content_, *v.value, v.flag);
+        const std::size_t offset = content_.size() - head - sizeof(std::size_t);
+        std::memcpy(&content_[head], &offset, sizeof(std::size_t));
+        content_.append(sizeof(std::size_t), '\0');
+        return *this;
+    }
+
+    template <class Ty>
+    archive& archive::update(variable_view<Ty> v) {
+        if (is_journaled()) {
+            return append_versions(true, v);
+        }
+        const std::string type_and_name = variable_tag<Ty>(v.name);
+        const auto        it            = find_offset_block(type_and_name);
+        if (it == content_.cend()) {
+            throw std::invalid_argument("Can't find variable name!");
+        }
+        std::string value;
+        serializer<Ty>{}(value, *v.value, v.flag);
+
+        const std::size_t head   = static_cast<std::size_t>(it - content_.cbegin());
+        std::size_t       offset = 0;
+        std::memcpy(&offset, &content_[head], sizeof(std::size_t));
+        const std::size_t value_begin = head + sizeof(std::size_t) + type_and_name.size();
+        const std::size_t block_end   = head + sizeof(std::size_t) + (offset & ~offset_block_flag_mask);
+
+        // Same size and nothing (sub-index) depends on element positions.
+        if ((offset & offset_block_flag_mask) == 0 && block_end - value_begin == value.size()) {
+            std::memcpy(&content_[value_begin], value.data(), value.size());
+            return *this;
+        }
+        // A block with checksum keeps one, a field directory or sub-index is rebuilt for the new value.
+        const bool        sealed   = (offset & offset_block_has_checksum) != 0;
+        const std::size_t trailers = details::rebuild_block_trailers(&content_[head], value);
+        const std::size_t tail   = content_.size() - block_end;
+        if (tail <= value.size() * 4) {
+            content_.replace(value_begin, block_end - value_begin, value);
+            offset = (type_and_name.size() + value.size()) | trailers;
+            std::memcpy(&content_[head], &offset, sizeof(std::size_t));
+            if (sealed) {
+                details::seal_block(content_, head);
+            }
+        } else {
+            offset |= offset_block_erased;
+            std::memcpy(&content_[head], &offset, sizeof(std::size_t));
+            content_.resize(content_.size() - sizeof(std::size_t)); // End mark.
+            const std::size_t moved = content_.size();
+            offset = (type_and_name.size() + value.size()) | trailers;
+            content_.append(reinterpret_cast<const char*>(&offset), sizeof(std::size_t));
+            content_.append(type_and_name).append(value);
+            if (sealed) {
+                details::seal_block(content_, moved);
+            }
+            content_.append(sizeof(std::size_t), '\0');
+        }
+        return *this;
+    }
+
+    inline std::vector<std::size_t> archive::alive_offset_blocks() const {
+        // Alive blocks of plain content first, then those of journal segments from the oldest on, a newer block
+        // takes the place of the one with the same tag.
+        constexpr std::size_t word = sizeof(std::size_t);
+        std::vector<std::size_t> alive;
+        if (content_.empty()) {
+            return alive;
+        }
+        for (std::size_t p = 0, offset = 0; std::memcpy(&offset, content_.data() + p, word), offset != 0;
+             p += word + (offset & ~offset_block_flag_mask)) {
+            if ((offset & offset_block_erased) == 0) {
+                alive.push_back(p);
+            }
+        }
+        if (!is_journaled()) {
+            return alive;
+        }
+        std::vector<std::pair<std::size_t, std::size_t>> indices; // [index_begin, count], latest first.
+        visit_journal_indices([&](std::size_t index_begin, std::size_t count, std::size_t) {
+            indices.emplace_back(index_begin, count);
+            return false;
+        });
+        // Tag of a block is its type signature and name.
+        const char* const end = content_.data() + content_.size();
+        auto tag_of = [&](std::size_t block) {
+            const char*               p = content_.data() + block + word;
+            details::binary_type_node node;
+            const char*               e = details::parse_binary_type_signature(p, end, node) ?
+                                          static_cast<const char*>(std::memchr(p, '\0', end - p)) : nullptr;
+            const char* const         t = content_.data() + block + word;
+            return e == nullptr ? std::string_view(t, 0) : std::string_view(t, e + 1 - t);
+        };
+        std::unordered_map<std::string_view, std::size_t> position;
+        for (std::size_t i = 0; i != alive.size(); ++i) {
+            position.emplace(tag_of(alive[i]), i);
+        }
+        for (auto index = indices.rbegin(); index != indices.rend(); ++index) {
+            for (std::size_t i = 0; i != index->second; ++i) {
+                std::size_t block = 0;
+                std::memcpy(&block, content_.data() + index->first + word * (i + 1), word);
+                if (auto [it, inserted] = position.emplace(tag_of(block), alive.size()); inserted) {
+                    alive.push_back(block);
+                } else {
+                    alive[it->second] = block;
+                }
+            }
+        }
+        return alive;
+    }
+
+    template <class ... Ty>
+        requires (sizeof...(Ty) != 0)
+    archive& archive::append(variable_view<Ty> ... v) {
+        return append_versions(false, v...);
+    }
+
+    template <class ... Ty>
+    archive& archive::append_versions(bool keep_trailers, variable_view<Ty> ... v) {
+        constexpr std::size_t word     = sizeof(std::size_t);
+        constexpr std::size_t none     = std::string::npos;
+        // Current versions are looked up before any byte of the new segment is written.
+        std::array<std::size_t, sizeof...(Ty)> versions{};
+        versions.fill(none);
+        if (keep_trailers) {
+            std::size_t j = 0;
+            ((versions[j++] = [&](std::string_view name) {
+                const auto it = find_offset_block(variable_tag<Ty>(name));
+                return it == content_.cend() ? none : static_cast<std::size_t>(it - content_.cbegin());
+            }(v.name)), ...);
+        }
+        std::size_t           previous = 0;
+        if (is_journaled()) {
+            std::memcpy(&previous, content_.data() + content_.size() - journal_magic.size() - word, word);
+        } else if (content_.empty()) {
+            content_.append(word, '\0'); // Plain content the journal follows, it has nothing but its end mark.
+        }
+        std::array<std::size_t, sizeof...(Ty)> heads{};
+        std::size_t                             i = 0;
+        auto write_block = [&]<class T>(variable_view<T> var) {
+            const std::size_t head = content_.size();
+            content_.append(word, '\0');
+            content_.append(variable_tag<T>(var.name));
+            const std::size_t value_begin = content_.size();
+            serializer<T>{}(content_, *var.value, var.flag);
+            std::size_t trailers = 0, version = 0;
+            if (versions[i] != none) {
+                std::string value(content_, value_begin);
+                std::memcpy(&version, content_.data() + versions[i], word);
+                trailers = details::rebuild_block_trailers(content_.data() + versions[i], value);
+                content_.append(value, content_.size() - value_begin);
+            }
+            const std::size_t offset = (content_.size() - head - word) | trailers;
+            std::memcpy(&content_[head], &offset, word);
+            if (version & offset_block_has_checksum) {
+                details::seal_block(content_, head);
+            }
+            heads[i++] = head;
+        };
+        (write_block(v), ...);
+
+        const std::size_t index_begin = content_.size();
+        const std::size_t count       = heads.size();
+        content_.append(reinterpret_cast<const char*>(&count), word);
+        content_.append(reinterpret_cast<const char*>(heads.data()), count * word);
+        content_.append(reinterpret_cast<const char*>(&previous), word);
+        content_.append(reinterpret_cast<const char*>(&index_begin), word);
+        content_.append(journal_magic);
+        return *this;
+    }
+
+    inline void archive::compact() {
+        constexpr std::size_t word = sizeof(std::size_t);
+        const std::vector<std::size_t> alive = alive_offset_blocks();
+        std::string compacted;
+        for (auto block : alive) {
+            std::size_t offset = 0;
+            std::memcpy(&offset, content_.data() + block, word);
+            compacted.append(content_, block, word + (offset & ~offset_block_flag_mask));
+        }
+        compacted.append(word, '\0');
+        content_ = std::move(compacted);
+    }
+
     template <class Ty>
     constexpr auto std_text_value_of(const Ty& value) {
         std_basic_type_text_output_formatter formatter{0};
         return std_type_value_string(value, formatter);
     }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///                                      Constant emission
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // Writing a variable with constant_initialized emits an 'inline constexpr' declaration instead of cpod text, so
+    // that an '#include'd header has no dynamic initialization and its data lives in read only memory:
+    //     std::string          ->  std::string_view
+    //     sequences            ->  std::array at top level, std::span over a '<name>_data_<n>' array when nested.
+    //     sets and maps        ->  same as sequences, sorted by key (std::pair elements for maps).
+    //     pair, tuple, array   ->  same template over converted types.
+    // The output is meant for the C++ compiler only, cpod compiler doesn't accept it. Structures, and containers
+    // of them, ignore the flag.
+    // The including file needs <array>, <span>, <string_view>, <tuple> and <utility>.
+
+    namespace details {
+
+        template <class Ty>
+        std::string constant_type_name();
+
+        template <class STL>
+        std::string constant_element_type_name() {
+            if constexpr (std_template_library_type_traits<STL>::is_double) {
+                return std::format("std::pair<{}, {}>", constant_type_name<typename STL::key_type>(),
+                                                        constant_type_name<typename STL::mapped_type>());
+            } else {
+                return constant_type_name<typename STL::value_type>();
+            }
+        }
+
+        template <class Ty>
+        std::string constant_type_name() {
+            using traits = std_template_library_type_traits<Ty>;
+            if constexpr (std_string_type_traits<Ty>::value) {
+                return "std::string_view";
+            }
+            else if constexpr (std_basic_type<Ty>) {
+                return std::string(std_basic_type_traits<Ty>::name);
+            }
+            else if constexpr (std_template_library_range<Ty>) {
+                return std::format("std::span<const {}>", constant_element_type_name<Ty>());
+            }
+            else if constexpr (traits::identifier == 26) {
+                return std::format("std::pair<{}, {}>", constant_type_name<std::remove_cvref_t<typename Ty::first_type>>(),
+                                                        constant_type_name<std::remove_cvref_t<typename Ty::second_type>>());
+            }
+            else if constexpr (traits::identifier == 27) {
+                return std::format("std::array<{}, {}>", constant_type_name<typename Ty::value_type>(), std::tuple_size_v<Ty>);
+            }
+            else {
+                return [] <std::size_t ... I> (std::index_sequence<I...>) {
+                    std::string names;
+                    ((names.append(I == 0 ? "" : ", ").append(constant_type_name<std::tuple_element_t<I, Ty>>())), ...);
+                    return std::format("std::tuple<{}>", names);
+                }(std::make_index_sequence<std::tuple_size_v<Ty>>{});
+            }
+        }
+
+        // Whether all of the value is made of types above, structures (even nested in containers) are written as text.
+        template <class Ty>
+        constexpr bool constant_writable() {
+            using traits = std_template_library_type_traits<Ty>;
+            if constexpr (std_basic_type<Ty>) {
+                return true;
+            }
+            else if constexpr (std_template_library_range<Ty>) {
+                if constexpr (traits::is_double) {
+                    return constant_writable<typename Ty::key_type>() && constant_writable<typename Ty::mapped_type>();
+                } else {
+                    return constant_writable<typename Ty::value_type>();
+                }
+            }
+            else if constexpr (!traits::value) {
+                return false;
+            }
+            else if constexpr (traits::identifier == 26) {
+                return constant_writable<std::remove_cvref_t<typename Ty::first_type>>() &&
+                       constant_writable<std::remove_cvref_t<typename Ty::second_type>>();
+            }
+            else if constexpr (traits::identifier == 27) {
+                return constant_writable<typename Ty::value_type>();
+            }
+            else {
+                return [] <std::size_t ... I> (std::index_sequence<I...>) {
+                    return (constant_writable<std::tuple_element_t<I, Ty>>() && ...);
+                }(std::make_index_sequence<std::tuple_size_v<Ty>>{});
+            }
+        }
+
+        // Formats values, nested ranges become arrays declared ahead of the variable.
+        struct constant_value_writer {
+            std_basic_type_text_output_formatter formatter;
+            std::string_view                     name;
+            std::string                          declarations;
+            std::size_t                          arrays = 0;
+
+            template <class Ty>
+            void operator()(std::string& buf, const Ty& value) {
+                using traits = std_template_library_type_traits<Ty>;
+                if constexpr (std::is_integral_v<Ty> && std::is_signed_v<Ty> && sizeof(Ty) == sizeof(std::int64_t)) {
+                    // -9223372036854775808 is the negation of a literal that fits no signed type.
+                    if (value == std::numeric_limits<Ty>::min()) {
+                        buf.append("(-9223372036854775807 - 1)");
+                    } else {
+                        formatter(buf, value);
+                    }
+                }
+                else if constexpr (std::is_integral_v<Ty> && std::is_unsigned_v<Ty> && sizeof(Ty) == sizeof(std::uint64_t)) {
+                    formatter(buf, value);
+                    buf.append("ull"); // Decimal literals above INT64_MAX fit no signed type.
+                }
+                else if constexpr (std_basic_type<Ty>) {
+                    formatter(buf, value);
+                }
+                else if constexpr (std_template_library_range<Ty>) {
+                    if (value.begin() == value.end()) {
+                        buf.append("{}");
+                        return;
+                    }
+                    std::string array = std::format("{}_data_{}", name, arrays++);
+                    declarations.append(declaration(array, value)).append(";\n");
+                    buf.append(array);
+                }
+                else if constexpr (traits::identifier == 26) {
+                    buf.push_back('{');
+                    (*this)(buf, value.first);
+                    buf.append(", ");
+                    (*this)(buf, value.second);
+                    buf.push_back('}');
+                }
+                else if constexpr (traits::identifier == 27) {
+                    buf.append(std::tuple_size_v<Ty> == 0 ? "{" : "{{");
+                    for (std::size_t i = 0; i != value.size(); ++i) {
+                        buf.append(i == 0 ? "" : ", ");
+                        (*this)(buf, value[i]);
+                    }
+                    buf.append(std::tuple_size_v<Ty> == 0 ? "}" : "}}");
+                }
+                else {
+                    buf.push_back('{');
+                    std::apply([&](const auto& ... m) {
+                        std::size_t i = 0;
+                        ((buf.append(i++ == 0 ? "" : ", "), (*this)(buf, m)), ...);
+                    }, value);
+                    buf.push_back('}');
+                }
+            }
+
+            // Ranges are written as std::array, sets and maps are sorted so that lookups can binary search.
+            template <class STL>
+            std::string declaration(std::string_view id, const STL& range) {
+                using traits = std_template_library_type_traits<STL>;
+                std::vector<const typename STL::value_type*> elements;
+                for (const auto& e : range) {
+                    elements.push_back(&e);
+                }
+                if constexpr (traits::identifier >= 18) {
+                    std::ranges::stable_sort(elements, [](auto* l, auto* r) {
+                        if constexpr (traits::is_double) { return l->first < r->first; }
+                        else                             { return *l < *r; }
+                    });
+                }
+                std::string values;
+                for (std::size_t i = 0; i != elements.size(); ++i) {
+                    values.append(i == 0 ? "" : ", ");
+                    (*this)(values, *elements[i]);
+                }
+                return std::format("inline constexpr std::array<{}, {}> {} = {}{}{}", constant_element_type_name<STL>(),
+                                   elements.size(), id, elements.empty() ? "{" : "{{", values, elements.empty() ? "}" : "}}");
+            }
+        };
+
+        template <class Ty>
+        void write_constant_declaration(archive& arch, std::string_view name, const Ty& value, flag_t flag) {
+            constant_value_writer writer{std_basic_type_text_output_formatter{flag}, name, {}};
+            std::string declaration;
+            if constexpr (std_template_library_range<Ty>) {
+                declaration = writer.declaration(name, value);
+            } else {
+                declaration = std::format("inline constexpr {} {} = ", constant_type_name<Ty>(), name);
+                writer(declaration, value);
+            }
+            arch << writer.declarations;
+            arch.append_indent();
+            arch << declaration << ';';
+        }
+    }
+
+    // Lookups over sets and maps written with constant_initialized, they are sorted arrays so lookups binary search.
+    template <class Range, class Key>
+    constexpr bool constant_contains(const Range& set, const Key& key) {
+        return std::binary_search(std::ranges::begin(set), std::ranges::end(set), key);
+    }
+
+    // Returns pointer to the mapped value or nullptr, for multimaps it's the first one inserted.
+    template <class Range, class Key>
+    constexpr auto constant_find(const Range& map, const Key& key) {
+        auto i = std::lower_bound(std::ranges::begin(map), std::ranges::end(map), key,
+                                  [](const auto& e, const auto& k) { return e.first < k; });
+        return i != std::ranges::end(map) && !(key < i->first) ? &i->second : nullptr;
+    }
+
+    template <class Range, class Key>
+    constexpr auto constant_equal_range(const Range& map, const Key& key) {
+        auto first = std::lower_bound(std::ranges::begin(map), std::ranges::end(map), key,
+                                      [](const auto& e, const auto& k) { return e.first < k; });
+        auto last  = std::upper_bound(first, std::ranges::end(map), key,
+                                      [](const auto& k, const auto& e) { return k < e.first; });
+        return std::ranges::subrange(first, last);
+    }
     
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
     ///                                Basic serializer specialization
@@ -1325,6 +5471,12 @@ template <typename K, typename V, typename ... OtherStuff> \
     template <std_type Ty>
     struct serializer<Ty> {
         constexpr void operator()(archive& arch, std::string_view name, const Ty& v, flag_t flag) {
+            if constexpr (details::constant_writable<Ty>()) {
+                if (flag & constant_initialized) {
+                    details::write_constant_declaration(arch, name, v, flag);
+                    return;
+                }
+            }
             std_basic_type_text_output_formatter formatter{flag};
             arch.append_indent();
             arch << std_type_name_string<Ty>() << ' '
@@ -1336,6 +5488,58 @@ template <typename K, typename V, typename ... OtherStuff> \
             std_basic_type_binary_input_reader reader{flag};
             details::iterate_std_template_stuff_impl<Ty>{}(mem_begin, reader, v, 0);
         }
+        constexpr void operator()(std::string& buf, const Ty& v, flag_t flag) {
+            std_basic_type_binary_output_writer writer{flag};
+            details::iterate_std_template_stuff_impl<Ty>{}(buf, writer, v, 0);
+        }
+    };
+
+    // Aggregates without a serializer of their own, members are found by structured binding so that their names
+    // are unknown, text form names them m0, m1, ... by position (binary form has no names anyway).
+    // Aggregates with C array members are left to a serializer of their own.
+    template <class Ty>
+    concept automatic_structure_type = std::is_aggregate_v<Ty> && std::is_class_v<Ty> && !std_type<Ty> && !std::is_empty_v<Ty> &&
+                                       details::aggregate_member_count<Ty>() < details::aggregate_member_limit &&
+                                       details::aggregate_members_countable<Ty>();
+
+    namespace details {
+        inline constexpr std::string_view automatic_member_names[aggregate_member_limit] = {
+            "m0", "m1", "m2",  "m3",  "m4",  "m5",  "m6",  "m7",
+            "m8", "m9", "m10", "m11", "m12", "m13", "m14", "m15"
+        };
+    }
+
+    template <automatic_structure_type Ty>
+    struct serializer<Ty> {
+        static constexpr std::string_view type_name        = details::type_name_of<Ty>();
+        static constexpr bool             automatic_layout = true;
+
+        constexpr void operator()(archive& arch, std::string_view name, const Ty& v, flag_t flag) const {
+            auto_structure_description_writer<Ty> sw(arch, name);
+            std::size_t index = 0;
+            std::apply([&](const auto& ... m) {
+                ((serializer<std::remove_cvref_t<decltype(m)>>{}(arch, details::automatic_member_names[index++], m, flag & ~flag_t(constant_initialized)), arch << '\n'), ...);
+            }, details::tie_aggregate(v));
+        }
+        constexpr void operator()(std::string::const_iterator& mem_begin, Ty& v, flag_t flag) const {
+            if constexpr (details::binary_layout_compatible<Ty>::value) {
+                std::memcpy(&v, &*mem_begin, sizeof(Ty));
+                mem_begin += sizeof(Ty);
+            } else {
+                std::apply([&](auto& ... m) {
+                    (serializer<std::remove_cvref_t<decltype(m)>>{}(mem_begin, m, flag), ...);
+                }, details::tie_aggregate(v));
+            }
+        }
+        constexpr void operator()(std::string& buf, const Ty& v, flag_t flag) const {
+            if constexpr (details::binary_layout_compatible<Ty>::value) {
+                buf.append(reinterpret_cast<const char*>(&v), sizeof(Ty));
+            } else {
+                std::apply([&](const auto& ... m) {
+                    (serializer<std::remove_cvref_t<decltype(m)>>{}(buf, m, flag), ...);
+                }, details::tie_aggregate(v));
+            }
+        }
     };
     
 }
\ No newline at end of file
@@ -0,0 +1,391 @@
+﻿//
+// MIT License
+//
+// Copyright (c) 2025 Henry Du
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////////
+//        Benchmarks of cpod text writer, compiler, binary reader and inline mode.
+//        Build with optimization enabled e.g. g++ -std=c++20 -O2 cpod_bench.cpp -o cpod_bench
+//        Usage: cpod_bench [scale] > result.json
+////////////////////////////////////////////////////////////////////////////////////
+
+// Std headers must come first because test_v1.cpod.hpp is included inside a namespace below.
+#include <vector>
+#include <map>
+#include <string>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <utility>
+#include <set>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include "cpod.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace inline_data {
+#include "test_v1.cpod.hpp"
+}
+
+//////////////////////////////////////////////////////////////////////
+///                    Allocation and memory probes                ///
+//////////////////////////////////////////////////////////////////////
+
+static std::atomic<std::size_t> allocation_count = 0;
+// Heap bytes in use and their high-water mark, which each benchmark resets, so every row has its own peak.
+static std::atomic<std::size_t> live_heap_bytes  = 0;
+static std::atomic<std::size_t> peak_heap_bytes  = 0;
+
+// Every block is prefixed by its size so that unsized deletes can account for it.
+constexpr std::size_t allocation_header = alignof(std::max_align_t);
+
+void* operator new(std::size_t n) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n + allocation_header)) {
+        *static_cast<std::size_t*>(p) = n;
+        const std::size_t live = live_heap_bytes.fetch_add(n, std::memory_order_relaxed) + n;
+        for (std::size_t peak = peak_heap_bytes.load(std::memory_order_relaxed);
+             peak < live && !peak_heap_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed);) {}
+        return static_cast<char*>(p) + allocation_header;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n)                         { return operator new(n); }
+void  operator delete(void* p) noexcept {
+    if (p != nullptr) {
+        void* block = static_cast<char*>(p) - allocation_header;
+        live_heap_bytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+void  operator delete[](void* p) noexcept                   { operator delete(p); }
+void  operator delete(void* p, std::size_t) noexcept        { operator delete(p); }
+void  operator delete[](void* p, std::size_t) noexcept      { operator delete(p); }
+
+// Peak resident set size of the whole process in bytes, it never decreases so it's reported once for the run.
+static std::size_t peak_rss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+///                        Synthetic datasets                      ///
+//////////////////////////////////////////////////////////////////////
+
+struct personal_info {
+    std::string           name;
+    std::string           gender;
+    uint8_t               age;
+    std::set<std::string> emails;
+};
+
+template <>
+struct cpod::serializer<personal_info> : cpod::structure_serializer<personal_info> {
+    static constexpr std::string_view type_name = "personal_info";
+    static constexpr auto fields() {
+        return std::make_tuple(
+            field("name",   &personal_info::name),
+            field("gender", &personal_info::gender),
+            field("age",    &personal_info::age),
+            field("emails", &personal_info::emails)
+        );
+    }
+};
+
+using vertex_type = std::tuple<std::array<float, 3>, std::array<float, 3>, std::array<float, 2>>;
+using deep_map    = std::map<std::string, std::map<std::string, std::map<std::string, std::string>>>;
+
+// Distributions of <random> are implementation defined, so map raw engine output by hand to keep datasets reproducible.
+struct dataset_generator {
+    std::mt19937 engine{20250101u};
+
+    float next_float() {
+        return static_cast<float>(engine() % 2000001u) / 1000000.F - 1.F;
+    }
+    std::string next_string(std::size_t max_len) {
+        static constexpr std::string_view alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+        std::string s(1 + engine() % max_len, ' ');
+        for (auto& c : s) {
+            c = alphabet[engine() % alphabet.size()];
+        }
+        return s;
+    }
+    std::vector<vertex_type> mesh(std::size_t n) {
+        std::vector<vertex_type> v(n);
+        for (auto& [pos, col, uv] : v) {
+            for (auto& f : pos) { f = next_float(); }
+            for (auto& f : col) { f = next_float(); }
+            for (auto& f : uv)  { f = next_float(); }
+        }
+        return v;
+    }
+    deep_map strings(std::size_t n) {
+        deep_map m;
+        for (std::size_t i = 0; i != n; ++i) {
+            m[next_string(8)][next_string(8)][next_string(12)] = next_string(32);
+        }
+        return m;
+    }
+    std::vector<personal_info> people(std::size_t n) {
+        std::vector<personal_info> v(n);
+        for (auto& p : v) {
+            p.name   = next_string(16);
+            p.gender = engine() & 1 ? "Male" : "Female";
+            p.age    = static_cast<uint8_t>(engine() % 100);
+            for (std::size_t i = 0, e = 1 + engine() % 3; i != e; ++i) {
+                p.emails.insert(next_string(12) + "@example.com");
+            }
+        }
+        return v;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+///                          Measurement                           ///
+//////////////////////////////////////////////////////////////////////
+
+struct bench_result {
+    std::string name;
+    std::size_t bytes       = 0;   // Bytes processed by one iteration.
+    std::size_t iterations  = 0;
+    double      best_ns     = 0.0; // Best iteration.
+    std::size_t allocations = 0;   // Allocations of one iteration.
+    std::size_t peak_heap   = 0;   // Most heap bytes one iteration had in use beyond what was live before it.
+};
+
+// Each task is run 'iterations' times and the best time is reported, fn returns processed bytes.
+template <class Fn>
+bench_result run_bench(std::string name, std::size_t iterations, Fn fn) {
+    bench_result r{std::move(name)};
+    r.iterations = iterations;
+    r.best_ns    = 1e300;
+    for (std::size_t i = 0; i != iterations; ++i) {
+        const std::size_t allocs = allocation_count.load(std::memory_order_relaxed);
+        const std::size_t live   = live_heap_bytes.load(std::memory_order_relaxed);
+        peak_heap_bytes.store(live, std::memory_order_relaxed);
+        const auto        begin  = std::chrono::steady_clock::now();
+        r.bytes                  = fn();
+        const auto        end    = std::chrono::steady_clock::now();
+        r.allocations            = allocation_count.load(std::memory_order_relaxed) - allocs;
+        r.peak_heap              = std::max(r.peak_heap, peak_heap_bytes.load(std::memory_order_relaxed) - live);
+        r.best_ns = std::min(r.best_ns, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+    }
+    return r;
+}
+
+static std::string to_json(const std::vector<bench_result>& results, std::size_t scale) {
+    std::string out = std::format("{{\n  \"scale\": {},\n  \"process_peak_rss\": {},\n  \"benchmarks\": [\n", scale, peak_rss());
+    for (std::size_t i = 0; i != results.size(); ++i) {
+        const auto& r = results[i];
+        out += std::format("    {{\"name\": \"{}\", \"bytes\": {}, \"iterations\": {}, \"best_ns\": {:.0f}, "
+                           "\"bytes_per_second\": {:.0f}, \"allocations\": {}, \"peak_heap_bytes\": {}}}{}\n",
+                           r.name, r.bytes, r.iterations, r.best_ns,
+                           r.best_ns > 0 ? static_cast<double>(r.bytes) * 1e9 / r.best_ns : 0.0,
+                           r.allocations, r.peak_heap, i + 1 == results.size() ? "" : ",");
+    }
+    out += "  ]\n}\n";
+    return out;
+}
+
+int main(int argc, char** argv) {
+    const std::size_t scale      = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1;
+    const std::size_t iterations = 5;
+
+    dataset_generator gen;
+    const auto mesh    = gen.mesh(100000 * scale);
+    const auto strings = gen.strings(20000 * scale);
+    const auto people  = gen.people(10000 * scale);
+    std::vector<int> small(10000 * scale);
+    for (auto& i : small) { i = static_cast<int>(gen.engine()); }
+
+    std::vector<bench_result> results;
+    std::string mesh_text, strings_text, small_text, people_text;
+
+    // Text writer.
+    results.push_back(run_bench("text_write/mesh", iterations, [&] {
+        cpod::archive arch;
+        arch << cpod::var("mesh", mesh) << '\n';
+        mesh_text = std::move(arch.content());
+        return mesh_text.size();
+    }));
+    results.push_back(run_bench("text_write/deep_string_map", iterations, [&] {
+        cpod::archive arch;
+        arch << cpod::var("strings", strings) << '\n';
+        strings_text = std::move(arch.content());
+        return strings_text.size();
+    }));
+    results.push_back(run_bench("text_write/small_variables", iterations, [&] {
+        cpod::archive arch;
+        for (std::size_t i = 0; i != small.size(); ++i) {
+            arch << cpod::var(std::format("v{}", i), small[i]) << '\n';
+        }
+        small_text = std::move(arch.content());
+        return small_text.size();
+    }));
+    results.push_back(run_bench("text_write/structures", iterations, [&] {
+        cpod::archive arch;
+        for (std::size_t i = 0; i != people.size(); ++i) {
+            arch << cpod::var(std::format("p{}", i), people[i]) << '\n';
+        }
+        people_text = std::move(arch.content());
+        return people_text.size();
+    }));
+
+    // Compiler.
+    std::string mesh_bin, strings_bin, small_bin, people_bin;
+    auto compile = [&](const std::string& text, std::string& bin) {
+        cpod::archive arch(text);
+        arch.compile_content_default();
+        bin = std::move(arch.content());
+        return text.size();
+    };
+    results.push_back(run_bench("compile/mesh",            iterations, [&] { return compile(mesh_text,    mesh_bin);    }));
+    results.push_back(run_bench("compile/deep_string_map", iterations, [&] { return compile(strings_text, strings_bin); }));
+    results.push_back(run_bench("compile/small_variables", iterations, [&] { return compile(small_text,   small_bin);   }));
+    results.push_back(run_bench("compile/structures",      iterations, [&] { return compile(people_text,  people_bin);  }));
+
+    // Direct binary writer, skips both text formatting and compiling.
+    results.push_back(run_bench("binary_write/mesh", iterations, [&] {
+        cpod::archive arch;
+        arch.write_binary(cpod::var("mesh", mesh));
+        return arch.content().size();
+    }));
+    results.push_back(run_bench("binary_write/structures", iterations, [&] {
+        cpod::archive arch;
+        for (std::size_t i = 0; i != people.size(); ++i) {
+            arch.write_binary(cpod::var(std::format("p{}", i), people[i]));
+        }
+        return arch.content().size();
+    }));
+
+    // Binary lookup and decode.
+    results.push_back(run_bench("decode/mesh", iterations, [&] {
+        cpod::archive arch(mesh_bin);
+        std::vector<vertex_type> v;
+        arch >> cpod::var("mesh", v);
+        return mesh_bin.size();
+    }));
+    results.push_back(run_bench("decode/deep_string_map", iterations, [&] {
+        cpod::archive arch(strings_bin);
+        deep_map m;
+        arch >> cpod::var("strings", m);
+        return strings_bin.size();
+    }));
+    results.push_back(run_bench("decode/small_variables", 1, [&] {
+        cpod::archive arch(small_bin);
+        int value = 0;
+        for (std::size_t i = 0; i != small.size(); ++i) {
+            arch >> cpod::var(std::format("v{}", i), value);
+        }
+        return small_bin.size();
+    }));
+    results.push_back(run_bench("decode/structures", 1, [&] {
+        cpod::archive arch(people_bin);
+        personal_info p;
+        for (std::size_t i = 0; i != people.size(); ++i) {
+            p.emails.clear();
+            arch >> cpod::var(std::format("p{}", i), p);
+        }
+        return people_bin.size();
+    }));
+
+    // Competitor: hand written iostream text of the same mesh, the usual ad hoc format.
+    std::string mesh_stream_text;
+    results.push_back(run_bench("iostream_write/mesh", iterations, [&] {
+        std::ostringstream os;
+        os << mesh.size() << '\n';
+        for (auto& [pos, col, uv] : mesh) {
+            os << pos[0] << ' ' << pos[1] << ' ' << pos[2] << ' '
+               << col[0] << ' ' << col[1] << ' ' << col[2] << ' '
+               << uv[0]  << ' ' << uv[1]  << '\n';
+        }
+        mesh_stream_text = os.str();
+        return mesh_stream_text.size();
+    }));
+    results.push_back(run_bench("iostream_read/mesh", iterations, [&] {
+        std::istringstream is(mesh_stream_text);
+        std::size_t n = 0;
+        is >> n;
+        std::vector<vertex_type> v(n);
+        for (auto& [pos, col, uv] : v) {
+            is >> pos[0] >> pos[1] >> pos[2] >> col[0] >> col[1] >> col[2] >> uv[0] >> uv[1];
+        }
+        return mesh_stream_text.size();
+    }));
+
+    // Inline mode: data is already built by the C++ compiler, so materializing it is a plain copy.
+    // Compare it with decoding the same source at runtime.
+    std::string test_v1_bin;
+    {
+        std::ifstream source_file("test_v1.cpod.hpp");
+        std::string   source, line;
+        while (std::getline(source_file, line)) {
+            if (line.rfind("#include", 0) != 0) {
+                source.append(line).push_back('\n');
+            }
+        }
+        cpod::archive arch(source);
+        arch.compile_content_default();
+        test_v1_bin = std::move(arch.content());
+    }
+    results.push_back(run_bench("inline/test_v1_copy", iterations, [&] {
+        auto v = inline_data::position_color_uv_vertices;
+        auto n = inline_data::mesh_name;
+        return v.size() * sizeof(vertex_type) + n.size();
+    }));
+    if (!test_v1_bin.empty()) {
+        results.push_back(run_bench("inline/test_v1_decode", iterations, [&] {
+            cpod::archive arch(test_v1_bin);
+            std::vector<vertex_type> v;
+            std::string              n;
+            arch >> cpod::var("position_color_uv_vertices", v) >> cpod::var("mesh_name", n);
+            return v.size() * sizeof(vertex_type) + n.size();
+        }));
+    }
+
+    std::cout << to_json(results, scale);
+}
@@ -30,6 +30,7 @@
 #include <fstream>
 #include <string_view>
 #include <format>
+#include <filesystem>
 #include "cpod.hpp"
 
 int main() {
@@ -56,7 +57,9 @@ int main() {
         // With this line added mesh name will have this VER_1_0_0 suffix.
         // Comment this the version suffix will no more exist.
         {"MESH_VERSION_TAG", "\"VER_1_0_0\""}
-    });
+    },
+    // Repeated strings are stored once in a string table, reads resolve them transparently.
+    {.intern_strings = true});
 
     // Default binary archive has no any metadata (header/author...)
     // Add metadata as your will.
@@ -110,5 +113,12 @@ int main() {
     } else {
         std::cout << msg << '\n';
     }
-    
+
+    // Many compiled files can be loaded in one batch, each of them gets its own error message.
+    out_binary.close();
+    std::vector<std::filesystem::path> paths{"binary_vertices.cpod.bin", "."};
+    std::vector<cpod::archive>         archives;
+    auto errors = cpod::load_archives(paths, archives);
+    // true Not a regular file!
+    std::cout << std::boolalpha << (errors[0].empty() && archives[0].content() == arch.content()) << ' ' << errors[1] << '\n';
 }
\ No newline at end of file
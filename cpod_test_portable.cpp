@@ -0,0 +1,92 @@
+//
+// MIT License
+//
+// Copyright (c) 2025 Henry Du
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////
+//  A quick demo to show how to move compiled content between machines and check it
+////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include "cpod.hpp"
+
+int main() {
+    cpod::archive arch(R"(
+std::vector<double> weights = {0.5, 1.5, 2.5};
+std::map<std::string, std::vector<int>> scores = {{"Alice",{1,2}},{"Henry",{3}}};
+std::array<std::pair<int16_t, uint64_t>, 2> ids = {{1,100},{2,200}};
+)");
+    // Every block carries a CRC32C of its bytes, so damage on the way is noticed.
+    std::string msg = arch.compile_content_default({}, {.checksums = true});
+
+    // Portable content has 8 bytes little endian words and values whatever this machine is, send it anywhere.
+    std::string portable;
+    if (msg.empty()) {
+        msg = arch.to_portable(portable);
+    }
+
+    // The receiver converts it to its own layout, untrusted content should pass validate() after that.
+    cpod::archive received;
+    if (msg.empty()) {
+        msg = received.from_portable(portable);
+    }
+    if (msg.empty()) {
+        msg = received.validate();
+    }
+    // Checks only the checksums, at memory speed.
+    if (msg.empty()) {
+        msg = received.verify_checksums();
+    }
+
+    std::vector<double>                                   weights;
+    std::map<std::string, std::vector<int>>               scores;
+    std::array<std::pair<std::int16_t, std::uint64_t>, 2> ids{};
+    if (msg.empty()) {
+        received >> cpod::var("weights", weights) >> cpod::var("scores", scores) >> cpod::var("ids", ids);
+    }
+
+    // Flip one bit of the last weight, both the whole check and a checked read find it.
+    cpod::archive damaged(received.content());
+    damaged.content()[damaged.content().find(std::string_view(reinterpret_cast<const char*>(&weights.back()), sizeof(double)))] ^= 1;
+    const std::string found = damaged.verify_checksums();
+    bool              thrown = false;
+    try {
+        std::vector<double> w;
+        damaged >> cpod::var("weights", w, cpod::verify_checksum);
+    } catch (std::runtime_error&) {
+        thrown = true;
+    }
+
+    // cpodport
+    std::cout << portable.substr(0, cpod::archive::portable_magic.size()) << '\n';
+    // true
+    std::cout << std::boolalpha << (msg.empty() && received.content() == arch.content()) << '\n';
+    // 2.5 3 200
+    std::cout << weights.back() << ' ' << scores["Henry"][0] << ' ' << ids[1].second << '\n';
+    // Checksum mismatch. true
+    std::cout << found << ' ' << thrown << '\n';
+    return msg.empty() && weights.size() == 3 && ids[1].second == 200 && !found.empty() && thrown ? 0 : 1;
+}
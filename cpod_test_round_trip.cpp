@@ -0,0 +1,77 @@
+//
+// MIT License
+//
+// Copyright (c) 2025 Henry Du
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////
+//     A quick demo to show compiled content turned back into text and compiled again
+////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include "cpod.hpp"
+
+int main() {
+    const std::string source = R"(
+struct Role{
+    int id = 7;
+    std::string name = "Henry";
+    struct Vec{
+        float x = 1;
+        float y = -2.5;
+    }home;
+    std::vector<std::string> tags = {"admin","ops"};
+}role;
+std::map<std::string, std::vector<int>> scores = {{"Alice",{1,2}},{"Henry",{}}};
+)";
+    // Field directory records the fields of 'role' so it can be decompiled too.
+    cpod::archive arch(source);
+    std::string   msg = arch.compile_content_default({}, {.field_directory = true});
+
+    // Text of the decompiler is plain 'static inline const' declarations, it's also a valid C++ header.
+    std::string text;
+    if (msg.empty()) {
+        msg = arch.decompile([&text](std::string_view piece) { text.append(piece); });
+    }
+    std::cout << text;
+
+    // Compiling the text again gives back exactly the same content.
+    cpod::archive again(text);
+    if (msg.empty()) {
+        msg = again.compile_content_default({}, {.field_directory = true});
+    }
+    const bool same = msg.empty() && again.content() == arch.content();
+
+    std::map<std::string, std::vector<int>> scores;
+    float                                   y = 0;
+    if (same) {
+        again >> cpod::var("scores", scores) >> cpod::var("role.home.y", y);
+    }
+
+    // true
+    std::cout << std::boolalpha << same << '\n';
+    // -2.5
+    std::cout << y << '\n';
+    return same && scores["Alice"].size() == 2 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+//
+// MIT License
+//
+// Copyright (c) 2025 Henry Du
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////////
+//          A quick demo to show how many threads share one loaded archive
+////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <array>
+#include <span>
+#include <map>
+#include "cpod.hpp"
+
+int main() {
+    cpod::archive arch;
+    std::vector<int>           numbers(10000);
+    std::map<std::string, int> ages{{"Henry", 17}, {"Alice", 20}};
+    for (std::size_t i = 0; i != numbers.size(); ++i) {
+        numbers[i] = static_cast<int>(i);
+    }
+    arch.write_binary(cpod::var("numbers", numbers));
+    arch.write_binary(cpod::var("ages",    ages));
+
+    // A variable of compiled content can be replaced, here its size changes so the block is rewritten.
+    ages["Bob"] = 30;
+    arch.update(cpod::var("ages", ages));
+
+    // A std::span is written like a std::vector, and part of a container can be decoded into caller storage.
+    const std::span<const int> first_numbers(numbers.data(), 4);
+    std::vector<int>           first;
+    std::array<int, 3>         middle{};
+    arch.write_binary(cpod::var("first_numbers", first_numbers));
+    arch >> cpod::var("first_numbers", first);
+    arch.read_range("numbers", std::span(middle), 5000);
+    // 3 5002
+    std::cout << first.back() << ' ' << middle.back() << '\n';
+
+    // Content moves into the snapshot, it never changes from now on.
+    const cpod::snapshot shared(std::move(arch));
+
+    // Every thread reads the same snapshot at the same time, no copy nor lock is needed.
+    std::atomic<std::size_t> failures = 0;
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t != 8; ++t) {
+        workers.emplace_back([&shared, &failures, &numbers, &ages] {
+            for (int round = 0; round != 100; ++round) {
+                std::vector<int>           n;
+                std::map<std::string, int> a;
+                shared >> cpod::var("numbers", n) >> cpod::var("ages", a);
+                if (n != numbers || a != ages) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    // 0
+    std::cout << "Failed reads : " << failures << '\n';
+    // true
+    std::cout << std::boolalpha << shared.contains<std::vector<int>>("numbers") << '\n';
+    return failures == 0 ? 0 : 1;
+}
@@ -42,23 +42,18 @@ struct personal_info {
     std::set<std::string> emails;
 };
 
+// Describe fields once, text writer, binary writer and binary reader are all derived from it.
 template <>
-struct cpod::serializer<personal_info> {
+struct cpod::serializer<personal_info> : cpod::structure_serializer<personal_info> {
     // Required static variable.
     static constexpr std::string_view type_name = "personal_info";
-    constexpr void operator()(archive& arch, std::string_view name, const personal_info& v, flag_t flag) const {
-        auto_structure_description_writer<personal_info> sw(arch, name);
-        serializer<std::string>          {}(arch, "name", v.name, flag);     arch << '\n';   
-        serializer<std::string>          {}(arch, "gender", v.gender, flag); arch << '\n';
-        serializer<std::uint8_t>         {}(arch, "age", v.age, flag);       arch << '\n';
-        serializer<std::set<std::string>>{}(arch, "emails", v.emails, flag); arch << '\n';
-    }
-    constexpr void operator()(std::string::const_iterator& mem_begin, personal_info& v, flag_t flag) {
-        // Reader is much shorter and thus faster.
-        serializer<std::string>           {}(mem_begin, v.name, flag);
-        serializer<std::string>           {}(mem_begin, v.gender, flag);
-        serializer<std::uint8_t>          {}(mem_begin, v.age, flag);
-        serializer<std::set<std::string>> {}(mem_begin, v.emails, flag);
+    static constexpr auto fields() {
+        return std::make_tuple(
+            field("name",   &personal_info::name),
+            field("gender", &personal_info::gender),
+            field("age",    &personal_info::age),
+            field("emails", &personal_info::emails)
+        );
     }
 };
 
@@ -87,4 +82,9 @@ int main(int argc, char** argv) {
 
     // wotsukoroga94@gmail.com
     std::cout << *myself_cache.emails.begin() << '\n';
+
+    // Binary can also be written directly, it's the same as compiled text but no formatting nor parsing is involved.
+    cpod::archive binary_arch;
+    binary_arch.write_binary(cpod::var("personal_info_0", myself));
+    std::cout << std::boolalpha << (binary_arch.content() == arch.content()) << '\n';
 }
\ No newline at end of file